@@ -0,0 +1,285 @@
+// g++ -std=c++17 -O2 -march=native Benchmark/HashTableBenchmark.cpp -o hash_table_benchmark
+// ./hash_table_benchmark [min_log_size] [max_log_size]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../FixedHashSet/FixedHashSet.h"
+#include "../TrieMap/TrieMap.h"
+#include "../UnorderedMap/CompactUnorderedMap.h"
+#include "../UnorderedMap/FlatMap.h"
+#include "../UnorderedMap/UnorderedMap.h"
+
+// Every allocation carries its size in a header, so live heap bytes can be read at any point.
+static size_t allocated_bytes = 0;
+constexpr size_t kAllocationHeader = alignof(std::max_align_t);
+
+[[gnu::noinline]] void *operator new(size_t size) {
+    void *raw = std::malloc(size + kAllocationHeader);
+    if (raw == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t *>(raw) = size;
+    allocated_bytes += size;
+    return static_cast<char *>(raw) + kAllocationHeader;
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+    if (ptr != nullptr) {
+        void *raw = static_cast<char *>(ptr) - kAllocationHeader;
+        allocated_bytes -= *static_cast<size_t *>(raw);
+        std::free(raw);
+    }
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// Zipf(0.99) ranks in [0, n) by the method of Gray et al., "Quickly generating billion-record
+// synthetic databases": one O(n) zeta computation, then O(1) per sample.
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double theta = 0.99) : n_(n) {
+        zeta_n_ = 0;
+        for (size_t i = 1; i <= n; ++i) {
+            zeta_n_ += std::pow(1.0 / i, theta);
+        }
+        zeta_2_ = 1 + std::pow(0.5, theta);
+        alpha_ = 1 / (1 - theta);
+        eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta_2_ / zeta_n_);
+    }
+
+    template<class Generator>
+    size_t operator()(Generator &generator) {
+        double u = std::uniform_real_distribution<double>(0, 1)(generator);
+        double uz = u * zeta_n_;
+        if (uz < 1) {
+            return 0;
+        }
+        if (uz < zeta_2_) {
+            return std::min<size_t>(1, n_ - 1);
+        }
+        return std::min<size_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_), n_ - 1);
+    }
+
+private:
+    size_t n_;
+    double zeta_n_;
+    double zeta_2_;
+    double alpha_;
+    double eta_;
+};
+
+// Adapters give every container the same operations; the ones a container lacks are reported as "-".
+template<class Map>
+struct MapAdapter {
+    static constexpr bool kErase = true;
+    static constexpr bool kIterate = true;
+    Map map;
+
+    void Build(const std::vector<uint32_t> &keys) {
+        for (uint32_t key: keys) {
+            map[key] = key;
+        }
+    }
+    bool Contains(uint32_t key) const {
+        return map.find(key) != map.end();
+    }
+    void Erase(uint32_t key) {
+        map.erase(key);
+    }
+    uint64_t Iterate() const {
+        uint64_t sum = 0;
+        for (const auto &item: map) {
+            sum += item.second;
+        }
+        return sum;
+    }
+};
+
+struct TrieMapAdapter {
+    static constexpr bool kErase = true;
+    static constexpr bool kIterate = false;
+    TrieMapUInt<> map;
+
+    void Build(const std::vector<uint32_t> &keys) {
+        for (uint32_t key: keys) {
+            map.set(key, key >> 1);
+        }
+    }
+    bool Contains(uint32_t key) {
+        return map.has(key);
+    }
+    void Erase(uint32_t key) {
+        map.erase(key);
+    }
+    uint64_t Iterate() const {
+        return 0;
+    }
+};
+
+struct FixedHashSetAdapter {
+    static constexpr bool kErase = false;
+    static constexpr bool kIterate = false;
+    FixedHashSet set;
+
+    void Build(const std::vector<uint32_t> &keys) {
+        set.Initialize(std::vector<int>(keys.begin(), keys.end()));
+    }
+    bool Contains(uint32_t key) const {
+        return set.Contains(static_cast<int>(key));
+    }
+    void Erase(uint32_t) {}
+    uint64_t Iterate() const {
+        return 0;
+    }
+};
+
+class HashTableBenchmark {
+public:
+    HashTableBenchmark(int min_log_size, int max_log_size) : min_log_size_(min_log_size), max_log_size_(max_log_size) {}
+
+    void Run() {
+        std::printf("%-22s %8s %10s %10s %10s %10s %10s %10s %14s\n", "container", "keys", "size", "insert_ns",
+                    "hit_ns", "miss_ns", "erase_ns", "iterate_ns", "bytes_per_elem");
+        for (int log = min_log_size_; log <= max_log_size_; log += 2) {
+            size_t size = size_t(1) << log;
+            for (bool zipf: {false, true}) {
+                Prepare(size, zipf);
+                RunContainer<MapAdapter<UnorderedMap<uint32_t, uint32_t> > >("UnorderedMap");
+                RunContainer<MapAdapter<UnorderedMap<uint32_t, uint32_t, std::hash<uint32_t>, std::equal_to<uint32_t>,
+                        std::allocator<std::pair<const uint32_t, uint32_t> >, PowerOfTwoBucketPolicy, true> > >(
+                        "UnorderedMap+pool");
+                RunContainer<MapAdapter<CompactUnorderedMap<uint32_t, uint32_t> > >("CompactUnorderedMap");
+                RunContainer<MapAdapter<FlatMap<uint32_t, uint32_t> > >("FlatMap");
+                RunContainer<FixedHashSetAdapter>("FixedHashSet");
+                RunContainer<TrieMapAdapter>("TrieMapUInt");
+                RunContainer<MapAdapter<std::unordered_map<uint32_t, uint32_t> > >("std::unordered_map");
+                RunContainer<MapAdapter<std::map<uint32_t, uint32_t> > >("std::map");
+            }
+        }
+    }
+
+private:
+    // Small tables are rebuilt until kMinOperations operations or kBudgetNs have been spent, so the
+    // measurement rises above the clock resolution without slow builds repeating for minutes.
+    static constexpr size_t kMinOperations = 1 << 21;
+    static constexpr double kBudgetNs = 1e9;
+
+    int min_log_size_;
+    int max_log_size_;
+    std::mt19937_64 generator_{42};
+    const char *distribution_ = "";
+    std::vector<uint32_t> keys_;
+    std::vector<uint32_t> hits_;
+    std::vector<uint32_t> misses_;
+
+    // A bijective mix of the index gives distinct pseudo-random keys: the first half is inserted,
+    // the second half is only ever looked up. Hits follow the chosen distribution over inserted keys.
+    static uint32_t Key(uint32_t index) {
+        index ^= index >> 16;
+        index *= 0x85ebca6bu;
+        index ^= index >> 13;
+        index *= 0xc2b2ae35u;
+        index ^= index >> 16;
+        return index;
+    }
+
+    void Prepare(size_t size, bool zipf) {
+        distribution_ = zipf ? "zipf" : "uniform";
+        uint32_t offset = generator_();
+        keys_.resize(size);
+        misses_.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            keys_[i] = Key(offset + i);
+            misses_[i] = Key(offset + size + i);
+        }
+        hits_.resize(size);
+        if (zipf) {
+            ZipfGenerator rank(size);
+            for (auto &hit: hits_) {
+                hit = keys_[rank(generator_)];
+            }
+        } else {
+            for (auto &hit: hits_) {
+                hit = keys_[generator_() % size];
+            }
+        }
+    }
+
+    template<class Function>
+    static double Time(Function function) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template<class Adapter>
+    void RunContainer(const char *name) {
+        const size_t size = keys_.size();
+        const size_t repetitions = std::max<size_t>(1, kMinOperations / size);
+        double insert = 0, hit = 0, miss = 0, erase = 0, iterate = 0, bytes = 0;
+        size_t found = 0;
+        uint64_t checksum = 0;
+        size_t repetition = 0;
+        for (; repetition < repetitions && insert + hit + miss + erase + iterate < kBudgetNs; ++repetition) {
+            size_t before = allocated_bytes;
+            auto *adapter = new Adapter();
+            insert += Time([&]() { adapter->Build(keys_); });
+            bytes = double(allocated_bytes - before) / size;
+            hit += Time([&]() {
+                for (uint32_t key: hits_) {
+                    found += adapter->Contains(key);
+                }
+            });
+            miss += Time([&]() {
+                for (uint32_t key: misses_) {
+                    found += adapter->Contains(key);
+                }
+            });
+            iterate += Time([&]() { checksum += adapter->Iterate(); });
+            erase += Time([&]() {
+                for (uint32_t key: keys_) {
+                    adapter->Erase(key);
+                }
+            });
+            delete adapter;
+        }
+        if (found != repetition * size) {
+            std::fprintf(stderr, "%s: %zu lookups succeeded, expected %zu\n", name, found, repetition * size);
+            std::exit(1);
+        }
+        const double operations = double(repetition) * size;
+        std::printf("%-22s %8s %10zu %10.1f %10.1f %10.1f %10s %10s %14.1f\n", name, distribution_, size,
+                    insert / operations, hit / operations, miss / operations,
+                    Adapter::kErase ? Format(erase / operations).c_str() : "-",
+                    Adapter::kIterate ? Format(iterate / operations).c_str() : "-", bytes);
+        std::fflush(stdout);
+        sink_ += checksum;
+    }
+
+    static std::string Format(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+        return buffer;
+    }
+
+    uint64_t sink_ = 0;
+};
+
+int main(int argc, char **argv) {
+    int min_log_size = argc > 1 ? std::atoi(argv[1]) : 10;
+    int max_log_size = argc > 2 ? std::atoi(argv[2]) : 22;
+    HashTableBenchmark(min_log_size, max_log_size).Run();
+}
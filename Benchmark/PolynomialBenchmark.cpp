@@ -0,0 +1,116 @@
+// g++ -std=c++17 -O2 -march=native -pthread Benchmark/PolynomialBenchmark.cpp -o polynomial_benchmark
+// ./polynomial_benchmark [max_log_size] [quadratic_log_limit]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "../fft/fft.h"
+
+class PolynomialBenchmark {
+public:
+    PolynomialBenchmark(int max_log_size, int quadratic_log_limit)
+            : max_log_size_(max_log_size), quadratic_log_limit_(quadratic_log_limit) {}
+
+    void Run() {
+        std::printf("%10s %12s %12s %12s %12s %12s %12s %12s %14s\n", "size", "forward_ns", "pointwise_ns",
+                    "inverse_ns", "ntt_ns", "schoolbook_ns", "karatsuba_ns", "multiply_ns", "coeffs_per_sec");
+        for (int log = 4; log <= max_log_size_; ++log) {
+            RunSize(size_t(1) << log, log <= quadratic_log_limit_);
+        }
+    }
+
+private:
+    using Kernels = PolynomialKernels;
+
+    int max_log_size_;
+    int quadratic_log_limit_;
+    std::mt19937 generator_{42};
+
+    template<class Function>
+    static double Measure(Function function) {
+        using Clock = std::chrono::steady_clock;
+        const auto budget = std::chrono::milliseconds(200);
+        size_t iterations = 0;
+        auto start = Clock::now();
+        auto now = start;
+        do {
+            function();
+            ++iterations;
+            now = Clock::now();
+        } while (now - start < budget);
+        return std::chrono::duration<double, std::nano>(now - start).count() / iterations;
+    }
+
+    std::vector<int> RandomCoefficients(size_t size) {
+        std::vector<int> coefficients(size);
+        for (auto &c: coefficients) {
+            c = generator_() % Kernels::mod;
+        }
+        coefficients.back() = 1;
+        return coefficients;
+    }
+
+    static Polynomial ToPolynomial(const std::vector<int> &coefficients) {
+        Polynomial poly(int(coefficients.size()) - 1);
+        for (size_t i = 0; i < coefficients.size(); ++i) {
+            poly[i] = coefficients[i];
+        }
+        return poly;
+    }
+
+    void RunSize(size_t size, bool quadratic) {
+        std::vector<uint32_t> source(size), other(size);
+        for (size_t i = 0; i < size; ++i) {
+            source[i] = generator_() % Kernels::mod;
+            other[i] = generator_() % Kernels::mod;
+        }
+        std::vector<int> rev = Kernels::GetRev(size);
+        const auto forward_twiddles = Kernels::GetTwiddles(size, false);
+        const auto inverse_twiddles = Kernels::GetTwiddles(size, true);
+        const uint32_t reversed_n = static_cast<uint32_t>(Kernels::GetReversed(size));
+        std::vector<uint32_t> cf;
+        double forward = Measure([&]() {
+            cf = source;
+            Kernels::Fft(cf, rev, forward_twiddles);
+        });
+        double pointwise = Measure([&]() {
+            Kernels::PointwiseMultiply(cf, other, reversed_n);
+        });
+        double inverse = Measure([&]() {
+            cf = source;
+            Kernels::Fft(cf, rev, inverse_twiddles);
+        });
+
+        const std::vector<int> first_cf = RandomCoefficients(size / 2), second_cf = RandomCoefficients(size / 2);
+        const Polynomial first = ToPolynomial(first_cf), second = ToPolynomial(second_cf);
+        double ntt = Measure([&]() {
+            Kernels::NttMultiply(first_cf, second_cf, 1);
+        });
+        double multiply = Measure([&]() {
+            Polynomial product = first * second;
+        });
+        if (!quadratic) {
+            std::printf("%10zu %12.0f %12.0f %12.0f %12.0f %12s %12s %12.0f %14.3e\n", size, forward, pointwise,
+                        inverse, ntt, "-", "-", multiply, 1e9 * size / multiply);
+            return;
+        }
+        std::vector<int> product(size - 1);
+        double schoolbook = Measure([&]() {
+            Kernels::Schoolbook(first_cf.data(), first_cf.size(), second_cf.data(), second_cf.size(),
+                                product.data());
+        });
+        double karatsuba = Measure([&]() {
+            Kernels::Karatsuba(first_cf.data(), second_cf.data(), first_cf.size(), product.data());
+        });
+        std::printf("%10zu %12.0f %12.0f %12.0f %12.0f %12.0f %12.0f %12.0f %14.3e\n", size, forward, pointwise,
+                    inverse, ntt, schoolbook, karatsuba, multiply, 1e9 * size / multiply);
+    }
+};
+
+int main(int argc, char **argv) {
+    int max_log_size = argc > 1 ? std::atoi(argv[1]) : 23;
+    int quadratic_log_limit = argc > 2 ? std::atoi(argv[2]) : 12;
+    PolynomialBenchmark(max_log_size, quadratic_log_limit).Run();
+}
@@ -0,0 +1,79 @@
+// g++ -std=c++17 -O2 -march=native Benchmark/StringSortBenchmark.cpp -o string_sort_benchmark
+// ./string_sort_benchmark [count]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Sort/QuickSort.h"
+#include "../Sort/StringSort.h"
+
+class StringSortBenchmark {
+public:
+    explicit StringSortBenchmark(size_t count) : count_(count) {}
+
+    void Run() {
+        std::printf("%-22s %10s %14s %14s %14s\n", "keys", "count", "string_sort_ms", "std_sort_ms", "sort_ms");
+        RunKeys("random", 0, 4, 32);
+        RunKeys("shared_prefix_24", 24, 4, 16);
+        RunKeys("shared_prefix_256", 256, 4, 16);
+        RunKeys("short_alphabet_4", 0, 16, 16, 4);
+        RunKeys("duplicates", 0, 8, 8, 2);
+    }
+
+private:
+    size_t count_;
+    std::mt19937_64 generator_{42};
+
+    // count_ keys made of a common prefix of prefix_size bytes followed by a random tail of
+    // min_tail..max_tail bytes drawn from the first alphabet letters.
+    std::vector<std::string> Generate(size_t prefix_size, size_t min_tail, size_t max_tail, int alphabet) {
+        std::string prefix(prefix_size, 'p');
+        std::vector<std::string> keys(count_, prefix);
+        for (auto &key: keys) {
+            size_t tail = min_tail + generator_() % (max_tail - min_tail + 1);
+            for (size_t i = 0; i < tail; ++i) {
+                key += static_cast<char>('a' + generator_() % alphabet);
+            }
+        }
+        return keys;
+    }
+
+    template<class Function>
+    static double Time(const std::vector<std::string> &source, Function function) {
+        double best = 1e300;
+        for (int repetition = 0; repetition < 3; ++repetition) {
+            std::vector<std::string> keys = source;
+            auto start = std::chrono::steady_clock::now();
+            function(keys);
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count());
+            if (!std::is_sorted(keys.begin(), keys.end())) {
+                std::fprintf(stderr, "keys are not sorted\n");
+                std::exit(1);
+            }
+        }
+        return best;
+    }
+
+    void RunKeys(const char *name, size_t prefix_size, size_t min_tail, size_t max_tail, int alphabet = 26) {
+        std::vector<std::string> keys = Generate(prefix_size, min_tail, max_tail, alphabet);
+        double string_sort = Time(keys, [](std::vector<std::string> &v) { StringSort(v.begin(), v.end()); });
+        double std_sort = Time(keys, [](std::vector<std::string> &v) { std::sort(v.begin(), v.end()); });
+        double sort = Time(keys, [](std::vector<std::string> &v) {
+            Sort(v.begin(), v.end(), std::less<std::string>());
+        });
+        std::printf("%-22s %10zu %14.1f %14.1f %14.1f\n", name, count_, string_sort, std_sort, sort);
+        std::fflush(stdout);
+    }
+};
+
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    StringSortBenchmark(count).Run();
+}
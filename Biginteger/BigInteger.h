@@ -2,7 +2,8 @@
 
 #include <iostream>
 #include <vector>
-#include <complex>
+
+#include "../fft/DoubleFft.h"
 
 class BigInteger {
 public:
@@ -517,61 +518,18 @@ private:
         }
         return result;
     }
-    void fft(std::vector<std::complex<double>> &a, bool invert) const {
-        int n = a.size();
-        for (int i = 1, j = 0; i < n; ++i) {
-            int bit = n >> 1;
-            for (; j >= bit; bit >>= 1) {
-                j -= bit;
-            }
-            j += bit;
-            if (i < j) {
-                swap(a[i], a[j]);
-            }
-        }
-        for (int len = 2; len <= n; len <<= 1) {
-            double ang = 2 * M_PI / len * (invert ? -1 : 1);
-            std::complex<double> w_length(cos(ang), sin(ang));
-            for (int i = 0; i < n; i += len) {
-                std::complex<double> w(1);
-                for (int j = 0; j < len >> 1; ++j) {
-                    std::complex<double> u = a[i + j], v = a[i + j + (len >> 1)] * w;
-                    a[i + j] = u + v;
-                    a[i + j + (len >> 1)] = u - v;
-                    w *= w_length;
-                }
-            }
-        }
-        if (invert) {
-            for (int i = 0; i < n; ++i) {
-                a[i] /= n;
-            }
-        }
-    }
     void multiply(const std::vector<int> &a, const std::vector<int> &b, std::vector<int> &res) const {
-        std::vector<std::complex<double>> fa(a.begin(), a.end()), fb(b.begin(), b.end());
-        size_t n = 1;
-        while (n < std::max(a.size(), b.size())) {
-            n <<= 1;
-        }
-        n <<= 1;
-        fa.resize(n);
-        fb.resize(n);
-        fft(fa, false);
-        fft(fb, false);
-        for (size_t i = 0; i < n; ++i) {
-            fa[i] *= fb[i];
-        }
-        fft(fa, true);
-        res.resize(n);
-        for (size_t i = 0; i < n; ++i) {
-            res[i] = int(fa[i].real() + 0.5);
-        }
-        int add = 0;
-        for (size_t i = 0; i < n; ++i) {
-            res[i] += add;
-            add = res[i] / 10;
-            res[i] %= 10;
+        // The twiddle table only grows, so one engine per thread serves every product.
+        thread_local DoubleFft engine;
+        std::vector<long long> product = engine.ConvolveRounded(a, b);
+        res.assign(a.size() + b.size(), 0);
+        long long add = 0;
+        for (size_t i = 0; i < res.size(); ++i) {
+            if (i < product.size()) {
+                add += product[i];
+            }
+            res[i] = add % 10;
+            add /= 10;
         }
     }
     BigInteger mlt(const BigInteger &a, const BigInteger &b) const {
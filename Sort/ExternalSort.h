@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ParallelSort.h"
+#include "RadixSort.h"
+
+constexpr size_t kExternalMinBufferBytes = 1 << 16;
+
+struct FileCloser {
+    void operator()(std::FILE *file) const {
+        std::fclose(file);
+    }
+};
+
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+inline FilePtr OpenFile(const std::string &path, const char *mode) {
+    FilePtr file(std::fopen(path.c_str(), mode));
+    if (!file) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    return file;
+}
+
+// Closes a file that was written to. Write errors buffered by stdio only surface here, so the
+// result is checked instead of being left to FileCloser.
+inline void CloseFile(FilePtr &file, const std::string &path) {
+    std::FILE *raw = file.release();
+    bool failed = std::ferror(raw) != 0;
+    if (std::fclose(raw) != 0 || failed) {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+inline FilePtr OpenTemporaryFile() {
+    FilePtr file(std::tmpfile());
+    if (!file) {
+        throw std::runtime_error("cannot create a temporary file");
+    }
+    return file;
+}
+
+template<typename T>
+class RunReader {
+public:
+    RunReader(std::FILE *file, size_t buffer_size) : file_(file), buffer_(std::max<size_t>(buffer_size, 1)) {
+        Fill();
+    }
+
+    bool Empty() const {
+        return position_ == size_;
+    }
+    const T &Front() const {
+        return buffer_[position_];
+    }
+    void Pop() {
+        if (++position_ == size_) {
+            Fill();
+        }
+    }
+
+private:
+    std::FILE *file_;
+    std::vector<T> buffer_;
+    size_t position_ = 0;
+    size_t size_ = 0;
+
+    void Fill() {
+        position_ = 0;
+        size_ = std::fread(buffer_.data(), sizeof(T), buffer_.size(), file_);
+        if (size_ < buffer_.size() && std::ferror(file_)) {
+            throw std::runtime_error("cannot read a sorted run");
+        }
+    }
+};
+
+template<typename T>
+class RunWriter {
+public:
+    RunWriter(std::FILE *file, size_t buffer_size) : file_(file) {
+        buffer_.reserve(std::max<size_t>(buffer_size, 1));
+    }
+    void Push(const T &value) {
+        buffer_.push_back(value);
+        if (buffer_.size() == buffer_.capacity()) {
+            Flush();
+        }
+    }
+    void Flush() {
+        if (std::fwrite(buffer_.data(), sizeof(T), buffer_.size(), file_) != buffer_.size()) {
+            throw std::runtime_error("cannot write a sorted run");
+        }
+        buffer_.clear();
+    }
+
+private:
+    std::FILE *file_;
+    std::vector<T> buffer_;
+};
+
+// Tournament tree over k sources: tree_[0] holds the source with the smallest front, every internal
+// node holds the loser of the match played there, so replacing the winner replays one root path.
+template<typename T, class Comparator>
+class LoserTree {
+public:
+    LoserTree(std::vector<RunReader<T>> &sources, Comparator compare)
+            : sources_(sources), compare_(compare), tree_(std::max<size_t>(sources.size(), 1)) {
+        tree_[0] = sources_.size() == 1 ? 0 : Build(1);
+    }
+
+    bool Empty() const {
+        return sources_[tree_[0]].Empty();
+    }
+    const T &Front() const {
+        return sources_[tree_[0]].Front();
+    }
+    void Pop() {
+        size_t winner = tree_[0];
+        sources_[winner].Pop();
+        for (size_t node = (winner + sources_.size()) / 2; node > 0; node /= 2) {
+            if (Beats(tree_[node], winner)) {
+                std::swap(tree_[node], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+
+private:
+    std::vector<RunReader<T>> &sources_;
+    Comparator compare_;
+    std::vector<size_t> tree_;
+
+    bool Beats(size_t first, size_t second) const {
+        if (sources_[first].Empty() || sources_[second].Empty()) {
+            return sources_[second].Empty() && (!sources_[first].Empty() || first < second);
+        }
+        if (compare_(sources_[first].Front(), sources_[second].Front())) {
+            return true;
+        }
+        return !compare_(sources_[second].Front(), sources_[first].Front()) && first < second;
+    }
+
+    size_t Build(size_t node) {
+        if (node >= sources_.size()) {
+            return node - sources_.size();
+        }
+        size_t left = Build(node * 2), right = Build(node * 2 + 1);
+        if (Beats(left, right)) {
+            tree_[node] = right;
+            return left;
+        }
+        tree_[node] = left;
+        return right;
+    }
+};
+
+template<typename T, class Comparator>
+void MergeRuns(std::vector<FilePtr> &runs, std::FILE *output, size_t memory_budget, Comparator compare) {
+    const size_t buffer_size = memory_budget / ((runs.size() + 1) * sizeof(T));
+    std::vector<RunReader<T>> readers;
+    readers.reserve(runs.size());
+    for (auto &run: runs) {
+        if (std::fflush(run.get()) != 0 || std::ferror(run.get())) {
+            throw std::runtime_error("cannot write a sorted run");
+        }
+        std::rewind(run.get());
+        readers.emplace_back(run.get(), buffer_size);
+    }
+    LoserTree<T, Comparator> tree(readers, compare);
+    RunWriter<T> writer(output, buffer_size);
+    while (!tree.Empty()) {
+        writer.Push(tree.Front());
+        tree.Pop();
+    }
+    writer.Flush();
+}
+
+// One intermediate pass: every group of fan_in consecutive runs is merged into a new run. Up to
+// threads groups are merged at once, each with an equal share of memory_budget, so the pass keeps
+// to the budget with read buffers that shrink by the number of concurrent merges.
+template<typename T, class Comparator>
+std::vector<FilePtr> MergePass(std::vector<FilePtr> &runs, size_t fan_in, size_t memory_budget, Comparator compare,
+                               size_t threads) {
+    const size_t groups = (runs.size() + fan_in - 1) / fan_in;
+    threads = std::min(threads, groups);
+    std::vector<FilePtr> merged;
+    for (size_t i = 0; i < groups; ++i) {
+        merged.push_back(OpenTemporaryFile());
+    }
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(threads);
+    RunThreads(threads, [&](size_t t) {
+        try {
+            for (size_t i = next++; i < groups; i = next++) {
+                std::vector<FilePtr> group;
+                for (size_t j = i * fan_in; j < std::min(runs.size(), (i + 1) * fan_in); ++j) {
+                    group.push_back(std::move(runs[j]));
+                }
+                MergeRuns<T>(group, merged[i].get(), memory_budget / threads, compare);
+            }
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    });
+    for (auto &error: errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return merged;
+}
+
+template<typename T, class Comparator>
+void SortRun(std::vector<T> &run, Comparator compare, size_t threads) {
+    if constexpr (std::is_same_v<T, uint64_t> &&
+                  (std::is_same_v<Comparator, std::less<uint64_t>> || std::is_same_v<Comparator, std::less<>>)) {
+        ParallelRadixSort(run.data(), 0, run.size() - 1, threads);
+    } else {
+        ParallelSort(run.begin(), run.end(), compare, threads);
+    }
+}
+
+// Sorts a file of fixed-size records T into output_path using about memory_budget bytes: runs of
+// half the budget are sorted in memory (radix sort for uint64_t, ParallelSort otherwise), spilled
+// to temporary files and merged through a loser tree with large sequential buffers. Runs beyond the
+// fan-in the budget allows are merged in several passes whose independent groups run on up to
+// threads threads; the final merge into output_path is a single sequential stream.
+template<typename T, class Comparator = std::less<T>>
+void ExternalSort(const std::string &input_path, const std::string &output_path, size_t memory_budget,
+                  Comparator compare = Comparator(), size_t threads = 0) {
+    static_assert(std::is_trivially_copyable_v<T>, "records are copied to and from files byte by byte");
+    memory_budget = std::max(memory_budget, 4 * kExternalMinBufferBytes);
+    const size_t run_size = std::max<size_t>(memory_budget / (2 * sizeof(T)), 1);
+    FilePtr input = OpenFile(input_path, "rb");
+    // ftell returns long, which is 32 bits on Windows, so the size comes from the filesystem.
+    std::error_code error;
+    const std::uintmax_t input_size = std::filesystem::file_size(input_path, error);
+    if (error) {
+        throw std::runtime_error("cannot read " + input_path);
+    }
+    if (input_size % sizeof(T) != 0) {
+        throw std::runtime_error(input_path + " is not a whole number of records");
+    }
+    const std::uintmax_t records = input_size / sizeof(T);
+    std::vector<FilePtr> runs;
+    std::vector<T> run(run_size);
+    while (true) {
+        size_t count = std::fread(run.data(), sizeof(T), run_size, input.get());
+        if (count < run_size && std::ferror(input.get())) {
+            throw std::runtime_error("cannot read " + input_path);
+        }
+        if (count == 0) {
+            break;
+        }
+        run.resize(count);
+        SortRun(run, compare, threads);
+        bool single_run = runs.empty() && count == records;
+        runs.push_back(single_run ? OpenFile(output_path, "wb") : OpenTemporaryFile());
+        if (std::fwrite(run.data(), sizeof(T), count, runs.back().get()) != count) {
+            throw std::runtime_error("cannot write a sorted run");
+        }
+        if (single_run) {
+            CloseFile(runs.back(), output_path);
+            return;
+        }
+        if (count < run_size) {
+            break;
+        }
+    }
+    if (runs.empty()) {
+        FilePtr output = OpenFile(output_path, "wb");
+        CloseFile(output, output_path);
+        return;
+    }
+    run = std::vector<T>();
+    const size_t fan_in = std::max<size_t>(memory_budget / kExternalMinBufferBytes - 1, 2);
+    const size_t merge_threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    while (runs.size() > fan_in) {
+        runs = MergePass<T>(runs, fan_in, memory_budget, compare, merge_threads);
+    }
+    FilePtr output = OpenFile(output_path, "wb");
+    MergeRuns<T>(runs, output.get(), memory_budget, compare);
+    CloseFile(output, output_path);
+}
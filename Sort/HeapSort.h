@@ -3,8 +3,102 @@
 #include <iostream>
 #include <vector>
 #include <cassert>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <functional>
 
-template<typename T>
+// Heaps below are max-heaps with respect to compare. A wider heap is shallower and reads a node's
+// children as one contiguous group, so a 4-ary or 8-ary heap sorts large arrays faster than a
+// binary one. The groups are not aligned to cache lines: HeapSort works in place on the caller's
+// array, and shifting the heap so that every group starts a line measured within noise.
+template<size_t Arity = 2, class Iterator, class Comparator>
+size_t MaxChild(Iterator begin, size_t first_child, size_t size, Comparator compare) {
+    size_t child = first_child;
+    if (first_child + Arity <= size) {
+        for (size_t i = first_child + 1; i < first_child + Arity; ++i) {
+            if (compare(begin[child], begin[i])) {
+                child = i;
+            }
+        }
+    } else {
+        for (size_t i = first_child + 1; i < size; ++i) {
+            if (compare(begin[child], begin[i])) {
+                child = i;
+            }
+        }
+    }
+    return child;
+}
+
+template<size_t Arity = 2, class Iterator, class Comparator>
+void SiftDown(Iterator begin, size_t size, size_t index, Comparator compare) {
+    auto value = std::move(begin[index]);
+    while (index * Arity + 1 < size) {
+        size_t child = MaxChild<Arity>(begin, index * Arity + 1, size, compare);
+        if (!compare(value, begin[child])) {
+            break;
+        }
+        begin[index] = std::move(begin[child]);
+        index = child;
+    }
+    begin[index] = std::move(value);
+}
+
+template<size_t Arity = 2, class Iterator, class Comparator>
+void SiftUp(Iterator begin, size_t index, Comparator compare) {
+    auto value = std::move(begin[index]);
+    while (index > 0) {
+        size_t parent = (index - 1) / Arity;
+        if (!compare(begin[parent], value)) {
+            break;
+        }
+        begin[index] = std::move(begin[parent]);
+        index = parent;
+    }
+    begin[index] = std::move(value);
+}
+
+template<size_t Arity = 2, class Iterator, class Comparator>
+void MakeHeap(Iterator begin, size_t size, Comparator compare) {
+    for (size_t i = size / Arity + 1; i-- > 0;) {
+        if (i < size) {
+            SiftDown<Arity>(begin, size, i, compare);
+        }
+    }
+}
+
+// Moves the maximum to begin[size - 1] and restores the heap on the first size - 1 elements with
+// Floyd's bottom-up method: the hole left by the root sinks to a leaf along the larger children
+// without comparing against the displaced element, which then sifts up the few levels it needs.
+template<size_t Arity = 2, class Iterator, class Comparator>
+void PopHeap(Iterator begin, size_t size, Comparator compare) {
+    if (size < 2) {
+        return;
+    }
+    const size_t last = size - 1;
+    auto value = std::move(begin[last]);
+    begin[last] = std::move(begin[0]);
+    size_t hole = 0;
+    while (hole * Arity + 1 < last) {
+        size_t child = MaxChild<Arity>(begin, hole * Arity + 1, last, compare);
+        begin[hole] = std::move(begin[child]);
+        hole = child;
+    }
+    begin[hole] = std::move(value);
+    SiftUp<Arity>(begin, hole, compare);
+}
+
+template<size_t Arity = 4, class Iterator, class Comparator>
+void HeapSort(Iterator begin, Iterator end, Comparator compare) {
+    size_t size = end - begin;
+    MakeHeap<Arity>(begin, size, compare);
+    for (size_t last = size; last > 1; --last) {
+        PopHeap<Arity>(begin, last, compare);
+    }
+}
+
+template<typename T, size_t Arity = 2>
 class Heap {
 public:
     Heap(std::vector<T> &arr) {
@@ -21,38 +115,14 @@ public:
 private:
     std::vector<T> heap;
 
-    void HeapSiftUp(int index) {
-        while (index > 0) {
-            int parent = (index - 1) / 2;
-            if (heap[parent] >= heap[index]) {
-                return;
-            }
-            std::swap(heap[index], heap[parent]);
-            index = parent;
-        }
+    void HeapSiftUp(size_t index) {
+        SiftUp<Arity>(heap.begin(), index, std::less<T>());
     }
-    void HeapSiftDown(int index) {
-        while (index * 2 + 1 < heap.size()) {
-            int left = index * 2 + 1,
-                    right = index * 2 + 2;
-            int next = index;
-            if (heap[left] > heap[next]) {
-                next = left;
-            }
-            if (right < heap.size() && heap[right] > heap[next]) {
-                next = right;
-            }
-            if (next == index) {
-                return;
-            }
-            std::swap(heap[next], heap[index]);
-            index = next;
-        }
+    void HeapSiftDown(size_t index) {
+        SiftDown<Arity>(heap.begin(), heap.size(), index, std::less<T>());
     }
     void HeapBuild() {
-        for (int i = heap.size() / 2 - 1; i >= 0; i--) {
-            HeapSiftDown(i);
-        }
+        MakeHeap<Arity>(heap.begin(), heap.size(), std::less<T>());
     }
     void HeapInsert(T value) {
         heap.push_back(value);
@@ -64,9 +134,8 @@ private:
     }
     void HeapExtractMax() {
         assert(heap.size() > 0);
-        std::swap(heap.front(), heap.back());
+        PopHeap<Arity>(heap.begin(), heap.size(), std::less<T>());
         heap.pop_back();
-        HeapSiftDown(0);
     }
     void HeapUpdate(T value) {
         if (value < HeapGetMax()) {
@@ -75,9 +144,94 @@ private:
         }
     }
     void HeapGetSortedElements(std::vector<T> &arr) {
-        for (int i = arr.size() - 1; i >= 0; i--) {
+        for (size_t i = arr.size(); i-- > 0;) {
             arr[i] = HeapGetMax();
             HeapExtractMax();
         }
     }
 };
+
+// Keeps the k elements that come first in the order given by Compare (the k smallest for
+// std::less, the k largest for std::greater) out of everything pushed, in a bounded heap whose
+// root is the worst element kept.
+template<typename T, class Compare = std::less<T>, size_t Arity = 2>
+class TopK {
+public:
+    TopK(size_t k, Compare compare = Compare()) : k_(k), compare_(compare) {
+        heap_.reserve(k);
+    }
+
+    void push(const T &value) {
+        push_(value);
+    }
+    void push(T &&value) {
+        push_(std::move(value));
+    }
+
+    template<class InputIt>
+    void push_range(InputIt first, InputIt last) {
+        if (k_ == 0) {
+            return;
+        }
+        bool was_full = full();
+        for (; first != last && heap_.size() < k_; ++first) {
+            heap_.push_back(*first);
+        }
+        if (!was_full) {
+            MakeHeap<Arity>(heap_.begin(), heap_.size(), compare_);
+        }
+        for (; first != last; ++first) {
+            if (compare_(*first, heap_.front())) {
+                heap_.front() = *first;
+                SiftDown<Arity>(heap_.begin(), heap_.size(), 0, compare_);
+            }
+        }
+    }
+
+    // The element a new value has to beat to get in; requires a non-empty heap.
+    const T &threshold() const {
+        assert(!heap_.empty());
+        return heap_.front();
+    }
+
+    // Kept elements in sorted order; the heap itself is left untouched.
+    std::vector<T> snapshot() const {
+        std::vector<T> result(heap_);
+        for (size_t last = result.size(); last > 1; --last) {
+            PopHeap<Arity>(result.begin(), last, compare_);
+        }
+        return result;
+    }
+
+    size_t size() const {
+        return heap_.size();
+    }
+    size_t capacity() const {
+        return k_;
+    }
+    bool empty() const {
+        return heap_.empty();
+    }
+    bool full() const {
+        return heap_.size() == k_;
+    }
+    void clear() {
+        heap_.clear();
+    }
+
+private:
+    size_t k_;
+    Compare compare_;
+    std::vector<T> heap_;
+
+    template<class Value>
+    void push_(Value &&value) {
+        if (heap_.size() < k_) {
+            heap_.push_back(std::forward<Value>(value));
+            SiftUp<Arity>(heap_.begin(), heap_.size() - 1, compare_);
+        } else if (k_ > 0 && compare_(value, heap_.front())) {
+            heap_.front() = std::forward<Value>(value);
+            SiftDown<Arity>(heap_.begin(), heap_.size(), 0, compare_);
+        }
+    }
+};
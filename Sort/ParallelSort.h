@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "QuickSort.h"
+
+constexpr std::ptrdiff_t kParallelSortCutoff = 1 << 14;
+
+// Introsort whose partitions are handed to a pool of workers. Every worker owns a deque of ranges,
+// takes the most recent range from its own deque and steals the oldest (largest) range from
+// another worker when it runs dry. A worker that finds nothing to steal sleeps until a range is
+// pushed or the sort is finished.
+template<class Iterator, class Comparator>
+class ParallelSorter {
+public:
+    ParallelSorter(Iterator begin, Iterator end, Comparator compare, size_t threads)
+            : begin_(begin), compare_(compare), queues_(threads), remaining_(end - begin), queued_(1) {
+        int depth_limit = 0;
+        for (auto size = end - begin; size > 1; size >>= 1) {
+            depth_limit += 2;
+        }
+        queues_[0].ranges.push_back({begin, end, depth_limit});
+    }
+
+    void Run() {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < queues_.size(); ++i) {
+            workers.emplace_back([this, i]() { Work(i); });
+        }
+        Work(0);
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+private:
+    static constexpr bool kBlock = UseBlockPartition<Iterator, Comparator>::value;
+
+    struct Range {
+        Iterator begin;
+        Iterator end;
+        int depth_limit;
+    };
+
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    Iterator begin_;
+    Comparator compare_;
+    std::vector<Queue> queues_;
+    std::atomic<std::ptrdiff_t> remaining_;
+    std::atomic<size_t> queued_;
+    std::mutex idle_mutex_;
+    std::condition_variable idle_;
+
+    void Push(size_t worker, Range range) {
+        {
+            std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+            queues_[worker].ranges.push_back(range);
+        }
+        queued_.fetch_add(1, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        idle_.notify_one();
+    }
+
+    // Marks count elements as placed and wakes every sleeping worker once all of them are.
+    void Finish(std::ptrdiff_t count) {
+        if (remaining_.fetch_sub(count, std::memory_order_acq_rel) == count) {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            idle_.notify_all();
+        }
+    }
+
+    bool Pop(size_t worker, Range &range) {
+        std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+        if (queues_[worker].ranges.empty()) {
+            return false;
+        }
+        range = queues_[worker].ranges.back();
+        queues_[worker].ranges.pop_back();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Steal(size_t worker, Range &range, std::mt19937 &generator) {
+        size_t offset = generator() % queues_.size();
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            size_t victim = (offset + i) % queues_.size();
+            if (victim == worker) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(queues_[victim].mutex);
+            if (!queues_[victim].ranges.empty()) {
+                range = queues_[victim].ranges.front();
+                queues_[victim].ranges.pop_front();
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Work(size_t worker) {
+        std::mt19937 generator(static_cast<unsigned>(worker));
+        Range range;
+        while (remaining_.load(std::memory_order_acquire) > 0) {
+            if (Pop(worker, range) || Steal(worker, range, generator)) {
+                Process(worker, range);
+            } else {
+                std::unique_lock<std::mutex> lock(idle_mutex_);
+                idle_.wait(lock, [this]() {
+                    return queued_.load(std::memory_order_acquire) > 0 ||
+                           remaining_.load(std::memory_order_acquire) <= 0;
+                });
+            }
+        }
+    }
+
+    void Process(size_t worker, Range range) {
+        auto [begin, end, depth_limit] = range;
+        while (end - begin > kParallelSortCutoff) {
+            if (depth_limit-- == 0) {
+                break;
+            }
+            ChoosePivot(begin, end, compare_);
+            if (begin != begin_ && !compare_(*(begin - 1), *begin)) {
+                Iterator equal_end = PartitionLeft(begin, end, compare_);
+                Finish(equal_end - begin);
+                begin = equal_end;
+                continue;
+            }
+            Iterator pivot = PartitionRight<kBlock>(begin, end, compare_).first;
+            Finish(1);
+            if (pivot - begin < end - pivot) {
+                Push(worker, {pivot + 1, end, depth_limit});
+                end = pivot;
+            } else {
+                Push(worker, {begin, pivot, depth_limit});
+                begin = pivot + 1;
+            }
+        }
+        if (depth_limit < 0) {
+            HeapSort(begin, end, compare_);
+        } else {
+            IntroSortLoop<kBlock>(begin, end, compare_, depth_limit, begin == begin_);
+        }
+        Finish(end - begin);
+    }
+};
+
+// Sorts like Sort() (same ordering, not stable) using the given number of threads, all hardware
+// threads by default.
+template<class Iterator, class Comparator>
+void ParallelSort(Iterator begin, Iterator end, Comparator compare, size_t threads = 0) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads == 1 || end - begin <= kParallelSortCutoff) {
+        Sort(begin, end, compare);
+        return;
+    }
+    if (SortMonotonicRun(begin, end, compare)) {
+        return;
+    }
+    ParallelSorter<Iterator, Comparator>(begin, end, compare, threads).Run();
+}
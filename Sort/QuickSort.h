@@ -2,6 +2,16 @@
 
 #include <iostream>
 #include <random>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#include "HeapSort.h"
+
+constexpr std::ptrdiff_t kInsertionSortThreshold = 24;
+constexpr std::ptrdiff_t kNintherThreshold = 128;
 
 template<class Iterator, class RandomGenerator>
 Iterator SelectPivot(Iterator begin, Iterator end, RandomGenerator& generator) {
@@ -39,9 +49,291 @@ void QuickSort(Iterator begin, Iterator end, Comparator compare, RandomGenerator
     QuickSort(mid + 1, end, compare, generator);
 }
 
+template<class Iterator, class Comparator>
+void InsertionSort(Iterator begin, Iterator end, Comparator compare) {
+    if (begin == end) {
+        return;
+    }
+    for (Iterator it = begin + 1; it != end; ++it) {
+        if (!compare(*it, *(it - 1))) {
+            continue;
+        }
+        auto value = std::move(*it);
+        Iterator hole = it;
+        do {
+            *hole = std::move(*(hole - 1));
+            --hole;
+        } while (hole != begin && compare(value, *(hole - 1)));
+        *hole = std::move(value);
+    }
+}
+
+template<class Iterator, class Comparator>
+void SortThree(Iterator first, Iterator second, Iterator third, Comparator compare) {
+    if (compare(*second, *first)) {
+        std::iter_swap(first, second);
+    }
+    if (compare(*third, *second)) {
+        std::iter_swap(second, third);
+        if (compare(*second, *first)) {
+            std::iter_swap(first, second);
+        }
+    }
+}
+
+// Moves the median of three (or Tukey's ninther on large ranges) to *begin.
+template<class Iterator, class Comparator>
+void ChoosePivot(Iterator begin, Iterator end, Comparator compare) {
+    std::ptrdiff_t size = end - begin;
+    Iterator mid = begin + size / 2;
+    if (size > kNintherThreshold) {
+        SortThree(begin, mid, end - 1, compare);
+        SortThree(begin + 1, mid - 1, end - 2, compare);
+        SortThree(begin + 2, mid + 1, end - 3, compare);
+        SortThree(mid - 1, mid, mid + 1, compare);
+        std::iter_swap(begin, mid);
+    } else {
+        SortThree(mid, begin, end - 1, compare);
+    }
+}
+
+// Offsets of misplaced elements are collected for a block of kBlockSize elements from both ends
+// without branching on comparisons, then the misplaced elements are swapped in bulk.
+constexpr size_t kBlockSize = 64;
+constexpr size_t kPartialInsertionSortLimit = 8;
+
+template<class Iterator, class Comparator>
+struct UseBlockPartition {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    static constexpr bool value = std::is_arithmetic_v<T> &&
+                                  (std::is_same_v<Comparator, std::less<T>> || std::is_same_v<Comparator, std::less<>> ||
+                                   std::is_same_v<Comparator, std::greater<T>> ||
+                                   std::is_same_v<Comparator, std::greater<>>);
+};
+
+template<class Iterator>
+void SwapOffsets(Iterator first, Iterator last, const unsigned char *offsets_left,
+                 const unsigned char *offsets_right, size_t count, bool use_swaps) {
+    if (use_swaps) {
+        for (size_t i = 0; i < count; ++i) {
+            std::iter_swap(first + offsets_left[i], last - offsets_right[i]);
+        }
+    } else if (count > 0) {
+        Iterator left = first + offsets_left[0];
+        Iterator right = last - offsets_right[0];
+        auto value = std::move(*left);
+        *left = std::move(*right);
+        for (size_t i = 1; i < count; ++i) {
+            left = first + offsets_left[i];
+            *right = std::move(*left);
+            right = last - offsets_right[i];
+            *left = std::move(*right);
+        }
+        *right = std::move(value);
+    }
+}
+
+template<class Iterator, class Comparator>
+void BlockPartition(Iterator &first, Iterator &last, const typename std::iterator_traits<Iterator>::value_type &pivot,
+                    Comparator compare) {
+    unsigned char offsets_left[kBlockSize];
+    unsigned char offsets_right[kBlockSize];
+    Iterator offsets_left_base = first;
+    Iterator offsets_right_base = last;
+    size_t count_left = 0, count_right = 0, start_left = 0, start_right = 0;
+    while (first < last) {
+        size_t unknown = last - first;
+        size_t left_split = count_left == 0 ? (count_right == 0 ? unknown / 2 : unknown) : 0;
+        size_t right_split = count_right == 0 ? unknown - left_split : 0;
+        left_split = std::min(left_split, kBlockSize);
+        right_split = std::min(right_split, kBlockSize);
+        for (size_t i = 0; i < left_split; ++i) {
+            offsets_left[count_left] = static_cast<unsigned char>(i);
+            count_left += !compare(*first, pivot);
+            ++first;
+        }
+        for (size_t i = 0; i < right_split;) {
+            offsets_right[count_right] = static_cast<unsigned char>(++i);
+            count_right += compare(*--last, pivot);
+        }
+        size_t count = std::min(count_left, count_right);
+        SwapOffsets(offsets_left_base, offsets_right_base, offsets_left + start_left, offsets_right + start_right,
+                    count, count_left == count_right);
+        count_left -= count;
+        count_right -= count;
+        start_left += count;
+        start_right += count;
+        if (count_left == 0) {
+            start_left = 0;
+            offsets_left_base = first;
+        }
+        if (count_right == 0) {
+            start_right = 0;
+            offsets_right_base = last;
+        }
+    }
+    while (count_left--) {
+        std::iter_swap(offsets_left_base + offsets_left[start_left + count_left], --last);
+        first = last;
+    }
+    while (count_right--) {
+        std::iter_swap(offsets_right_base - offsets_right[start_right + count_right], first);
+        last = ++first;
+    }
+}
+
+// Partitions [begin + 1, end) around the pivot *begin into elements less than it and the rest. Requires an
+// element not less than the pivot after begin, which ChoosePivot guarantees. Returns the final position of
+// the pivot and whether the range was already partitioned.
+template<bool Block, class Iterator, class Comparator>
+std::pair<Iterator, bool> PartitionRight(Iterator begin, Iterator end, Comparator compare) {
+    auto pivot = std::move(*begin);
+    Iterator first = begin;
+    Iterator last = end;
+    while (compare(*++first, pivot)) {
+    }
+    if (first - 1 == begin) {
+        while (first < last && !compare(*--last, pivot)) {
+        }
+    } else {
+        while (!compare(*--last, pivot)) {
+        }
+    }
+    bool already_partitioned = first >= last;
+    if (!already_partitioned) {
+        std::iter_swap(first, last);
+        ++first;
+        if constexpr (Block) {
+            BlockPartition(first, last, pivot, compare);
+        } else {
+            for (Iterator it = first; it != last; ++it) {
+                bool less = compare(*it, pivot);
+                std::iter_swap(first, it);
+                first += less;
+            }
+        }
+    }
+    Iterator pivot_position = first - 1;
+    *begin = std::move(*pivot_position);
+    *pivot_position = std::move(pivot);
+    return {pivot_position, already_partitioned};
+}
+
+// Same as PartitionRight, but puts elements equal to the pivot on the left; returns the end of them.
+template<class Iterator, class Comparator>
+Iterator PartitionLeft(Iterator begin, Iterator end, Comparator compare) {
+    Iterator first = begin + 1;
+    for (Iterator it = begin + 1; it != end; ++it) {
+        bool not_greater = !compare(*begin, *it);
+        std::iter_swap(first, it);
+        first += not_greater;
+    }
+    return first;
+}
+
+// Insertion sort that gives up after kPartialInsertionSortLimit moves; returns whether it finished.
+template<class Iterator, class Comparator>
+bool PartialInsertionSort(Iterator begin, Iterator end, Comparator compare) {
+    if (begin == end) {
+        return true;
+    }
+    size_t moves = 0;
+    for (Iterator it = begin + 1; it != end; ++it) {
+        if (!compare(*it, *(it - 1))) {
+            continue;
+        }
+        auto value = std::move(*it);
+        Iterator hole = it;
+        do {
+            *hole = std::move(*(hole - 1));
+            --hole;
+        } while (hole != begin && compare(value, *(hole - 1)));
+        *hole = std::move(value);
+        moves += it - hole;
+        if (moves > kPartialInsertionSortLimit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<bool Block, class Iterator, class Comparator>
+void IntroSortLoop(Iterator begin, Iterator end, Comparator compare, int depth_limit, bool leftmost) {
+    while (end - begin > kInsertionSortThreshold) {
+        if (depth_limit-- == 0) {
+            HeapSort(begin, end, compare);
+            return;
+        }
+        ChoosePivot(begin, end, compare);
+        if (!leftmost && !compare(*(begin - 1), *begin)) {
+            begin = PartitionLeft(begin, end, compare);
+            continue;
+        }
+        auto [pivot, already_partitioned] = PartitionRight<Block>(begin, end, compare);
+        std::ptrdiff_t size = end - begin;
+        bool balanced = pivot - begin >= size / 8 && end - pivot > size / 8;
+        if (already_partitioned && balanced && PartialInsertionSort(begin, pivot, compare) &&
+            PartialInsertionSort(pivot + 1, end, compare)) {
+            return;
+        }
+        if (pivot - begin < end - pivot) {
+            IntroSortLoop<Block>(begin, pivot, compare, depth_limit, leftmost);
+            begin = pivot + 1;
+            leftmost = false;
+        } else {
+            IntroSortLoop<Block>(pivot + 1, end, compare, depth_limit, false);
+            end = pivot;
+        }
+    }
+    InsertionSort(begin, end, compare);
+}
+
+// Returns true if the range was already sorted or strictly descending, reversing it in the latter case.
+template<class Iterator, class Comparator>
+bool SortMonotonicRun(Iterator begin, Iterator end, Comparator compare) {
+    if (end - begin < 2) {
+        return true;
+    }
+    Iterator it = begin + 1;
+    if (compare(*it, *begin)) {
+        while (it != end && compare(*it, *(it - 1))) {
+            ++it;
+        }
+        if (it == end) {
+            std::reverse(begin, end);
+            return true;
+        }
+    } else {
+        while (it != end && !compare(*it, *(it - 1))) {
+            ++it;
+        }
+    }
+    return it == end;
+}
+
+template<bool Block, class Iterator, class Comparator>
+void IntroSort(Iterator begin, Iterator end, Comparator compare) {
+    if (SortMonotonicRun(begin, end, compare)) {
+        return;
+    }
+    int depth_limit = 0;
+    for (auto size = end - begin; size > 1; size >>= 1) {
+        depth_limit += 2;
+    }
+    IntroSortLoop<Block>(begin, end, compare, depth_limit, true);
+}
+
+template<class Iterator, class Comparator>
+void IntroSort(Iterator begin, Iterator end, Comparator compare) {
+    IntroSort<UseBlockPartition<Iterator, Comparator>::value>(begin, end, compare);
+}
+
+template<class Iterator, class Comparator>
+void BlockSort(Iterator begin, Iterator end, Comparator compare) {
+    IntroSort<true>(begin, end, compare);
+}
+
 template <class Iterator, class Comparator>
 void Sort(Iterator begin, Iterator end, Comparator compare) {
-    std::random_device rd;
-    std::mt19937_64 generator(rd());
-    QuickSort(begin, end, compare, generator);
+    IntroSort(begin, end, compare);
 }
\ No newline at end of file
@@ -2,34 +2,280 @@
 
 #include <iostream>
 #include <cstring>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <iterator>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
 
-int GetByte(uint64_t value, int p) {
-    return (value >> (8 * p)) % 256;
+inline int GetByte(uint64_t value, int p) {
+    return (value >> (8 * p)) & 0xff;
 }
 
-void ByteSort(uint64_t *arr, int l, int r, int p) {
-    int n = r - l + 1;
-    auto *a = new uint64_t[n];
-    std::memcpy(a, arr + l, sizeof(uint64_t) * n);
-    int *cnt = new int[256];
-    for (int i = 0; i < 256; ++i) {
-        cnt[i] = 0;
+// Stable scatter of n values by byte p, offsets holds the exclusive prefix sums of the byte counts.
+inline void ByteSort(const uint64_t *from, uint64_t *to, size_t n, int p, size_t *offsets) {
+    for (size_t i = 0; i < n; ++i) {
+        to[offsets[GetByte(from[i], p)]++] = from[i];
     }
-    for (int i = 0; i < n; ++i) {
-        ++cnt[GetByte(a[i], p)];
+}
+
+// Sorts arr[l..r]. All byte histograms are gathered in one pass, bytes with a single populated
+// bucket are skipped and the passes alternate between arr and one scratch buffer.
+inline void RadixSort(uint64_t *arr, size_t l, size_t r) {
+    size_t n = r - l + 1;
+    if (l > r || n < 2) {
+        return;
+    }
+    arr += l;
+    std::vector<size_t> count(8 * 256);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t value = arr[i];
+        for (int p = 0; p < 8; ++p) {
+            ++count[p * 256 + GetByte(value, p)];
+        }
+    }
+    std::vector<uint64_t> buffer;
+    uint64_t *from = arr, *to = nullptr;
+    for (int p = 0; p < 8; ++p) {
+        size_t *offsets = count.data() + p * 256;
+        if (offsets[GetByte(arr[0], p)] == n) {
+            continue;
+        }
+        if (to == nullptr) {
+            buffer.resize(n);
+            to = buffer.data();
+        }
+        size_t sum = 0;
+        for (int i = 0; i < 256; ++i) {
+            size_t current = offsets[i];
+            offsets[i] = sum;
+            sum += current;
+        }
+        ByteSort(from, to, n, p, offsets);
+        std::swap(from, to);
+    }
+    if (from != arr) {
+        std::memcpy(arr, from, sizeof(uint64_t) * n);
+    }
+}
+
+constexpr size_t kParallelRadixMinChunk = 1 << 16;
+constexpr size_t kWriteCombiningSize = 64 / sizeof(uint64_t);
+
+template<class Function>
+void RunThreads(size_t threads, Function function) {
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(function, t);
     }
-    for (int i = 1; i < 256; ++i) {
-        cnt[i] += cnt[i - 1];
+    function(0);
+    for (auto &thread: pool) {
+        thread.join();
     }
-    for (int i = n - 1; i >= 0; --i) {
-        arr[--cnt[GetByte(a[i], p)] + l] = a[i];
+}
+
+// Stable scatter by byte p through one cache line of staging per bucket. The first flush of a
+// bucket only fills up to the next 64-byte boundary of `to`, so every later flush stores one whole,
+// aligned line instead of touching 256 partially written lines.
+inline void WriteCombiningByteSort(const uint64_t *from, uint64_t *to, size_t n, int p, size_t *offsets) {
+    alignas(64) uint64_t lines[256][kWriteCombiningSize];
+    size_t fill[256] = {};
+    size_t limit[256];
+    for (int byte = 0; byte < 256; ++byte) {
+        size_t misalignment = reinterpret_cast<uintptr_t>(to + offsets[byte]) / sizeof(uint64_t) % kWriteCombiningSize;
+        limit[byte] = kWriteCombiningSize - misalignment;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        int byte = GetByte(from[i], p);
+        lines[byte][fill[byte]++] = from[i];
+        if (fill[byte] == limit[byte]) {
+            std::memcpy(to + offsets[byte], lines[byte], sizeof(uint64_t) * fill[byte]);
+            offsets[byte] += fill[byte];
+            fill[byte] = 0;
+            limit[byte] = kWriteCombiningSize;
+        }
+    }
+    for (int byte = 0; byte < 256; ++byte) {
+        std::memcpy(to + offsets[byte], lines[byte], sizeof(uint64_t) * fill[byte]);
+        offsets[byte] += fill[byte];
     }
-    delete[] a;
-    delete[] cnt;
 }
 
-void RadixSort(uint64_t *arr, int l, int r) {
-    for (int i = 0; i < 8; ++i) {
-        ByteSort(arr, l, r, i);
+// Sorts arr[l..r] like RadixSort with the array split into one chunk per thread. Every pass
+// histograms the chunks concurrently, turns the per-thread counts into scatter offsets ordered by
+// bucket and then by thread, and scatters all chunks concurrently.
+inline void ParallelRadixSort(uint64_t *arr, size_t l, size_t r, size_t threads = 0) {
+    size_t n = r - l + 1;
+    if (l > r || n < 2) {
+        return;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
-}
\ No newline at end of file
+    threads = std::min(threads, std::max<size_t>(1, n / kParallelRadixMinChunk));
+    if (threads == 1) {
+        RadixSort(arr, l, r);
+        return;
+    }
+    arr += l;
+    const size_t chunk = (n + threads - 1) / threads;
+    auto chunk_begin = [&](size_t t) { return std::min(n, t * chunk); };
+    std::vector<size_t> count(threads * 8 * 256);
+    auto histogram = [&](size_t t, int p) { return count.data() + (t * 8 + p) * 256; };
+    RunThreads(threads, [&](size_t t) {
+        for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+            uint64_t value = arr[i];
+            for (int p = 0; p < 8; ++p) {
+                ++histogram(t, p)[GetByte(value, p)];
+            }
+        }
+    });
+    std::vector<uint64_t> buffer;
+    uint64_t *from = arr, *to = nullptr;
+    for (int p = 0; p < 8; ++p) {
+        size_t total = 0;
+        for (size_t t = 0; t < threads; ++t) {
+            total += histogram(t, p)[GetByte(arr[0], p)];
+        }
+        if (total == n) {
+            continue;
+        }
+        if (to == nullptr) {
+            buffer.resize(n);
+            to = buffer.data();
+        } else {
+            RunThreads(threads, [&](size_t t) {
+                size_t *bucket_count = histogram(t, p);
+                std::fill(bucket_count, bucket_count + 256, 0);
+                for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+                    ++bucket_count[GetByte(from[i], p)];
+                }
+            });
+        }
+        size_t sum = 0;
+        for (int byte = 0; byte < 256; ++byte) {
+            for (size_t t = 0; t < threads; ++t) {
+                size_t current = histogram(t, p)[byte];
+                histogram(t, p)[byte] = sum;
+                sum += current;
+            }
+        }
+        RunThreads(threads, [&](size_t t) {
+            WriteCombiningByteSort(from + chunk_begin(t), to, chunk_begin(t + 1) - chunk_begin(t), p,
+                                   histogram(t, p));
+        });
+        std::swap(from, to);
+    }
+    if (from != arr) {
+        std::memcpy(arr, from, sizeof(uint64_t) * n);
+    }
+}
+
+// Maps a key to an unsigned integer with the same order: signed integers get their sign bit flipped,
+// IEEE floats get all bits flipped when negative and the sign bit set otherwise, so -0.0 sorts
+// before 0.0 and NaNs end up at the extremes.
+template<class Key, class Enable = void>
+struct RadixKey;
+
+template<class Key>
+struct RadixKey<Key, std::enable_if_t<std::is_integral_v<Key>>> {
+    using Unsigned = std::make_unsigned_t<Key>;
+
+    static Unsigned Encode(Key key) {
+        if constexpr (std::is_signed_v<Key>) {
+            return static_cast<Unsigned>(key) ^ (Unsigned(1) << (sizeof(Key) * 8 - 1));
+        } else {
+            return key;
+        }
+    }
+};
+
+template<class Key>
+struct RadixKey<Key, std::enable_if_t<std::is_floating_point_v<Key>>> {
+    static_assert(sizeof(Key) == 4 || sizeof(Key) == 8, "only IEEE single and double keys are supported");
+    using Unsigned = std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>;
+
+    static Unsigned Encode(Key key) {
+        Unsigned bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        const Unsigned sign = Unsigned(1) << (sizeof(Unsigned) * 8 - 1);
+        return bits & sign ? ~bits : bits | sign;
+    }
+};
+
+// Stable LSD sort of keys, moving payload[i] along with keys[i].
+template<class Unsigned, class Payload>
+void RadixSortPairs(std::vector<Unsigned> &keys, std::vector<Payload> &payload) {
+    constexpr int kBytes = sizeof(Unsigned);
+    const size_t n = keys.size();
+    if (n < 2) {
+        return;
+    }
+    std::vector<size_t> count(kBytes * 256);
+    for (size_t i = 0; i < n; ++i) {
+        for (int p = 0; p < kBytes; ++p) {
+            ++count[p * 256 + GetByte(keys[i], p)];
+        }
+    }
+    std::vector<Unsigned> keys_buffer;
+    std::vector<Payload> payload_buffer;
+    for (int p = 0; p < kBytes; ++p) {
+        size_t *offsets = count.data() + p * 256;
+        if (offsets[GetByte(keys[0], p)] == n) {
+            continue;
+        }
+        if (keys_buffer.empty()) {
+            keys_buffer.resize(n);
+            payload_buffer.resize(n);
+        }
+        size_t sum = 0;
+        for (int i = 0; i < 256; ++i) {
+            size_t current = offsets[i];
+            offsets[i] = sum;
+            sum += current;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t position = offsets[GetByte(keys[i], p)]++;
+            keys_buffer[position] = keys[i];
+            payload_buffer[position] = std::move(payload[i]);
+        }
+        keys.swap(keys_buffer);
+        payload.swap(payload_buffer);
+    }
+}
+
+constexpr size_t kRadixRecordSize = 32;
+
+// Stable radix sort of records by an integral or floating point key. Small trivially copyable
+// records are scattered together with their keys; larger ones are sorted as indices and moved
+// into place once at the end.
+template<class Iterator, class KeyFunction>
+void RadixSortBy(Iterator begin, Iterator end, KeyFunction key_fn) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    using Key = std::decay_t<std::invoke_result_t<KeyFunction, const T &>>;
+    using Unsigned = typename RadixKey<Key>::Unsigned;
+    const size_t n = end - begin;
+    std::vector<Unsigned> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = RadixKey<Key>::Encode(key_fn(begin[i]));
+    }
+    if constexpr (std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> &&
+                  sizeof(T) <= kRadixRecordSize) {
+        std::vector<T> records(begin, end);
+        RadixSortPairs(keys, records);
+        std::copy(records.begin(), records.end(), begin);
+    } else {
+        std::vector<size_t> index(n);
+        std::iota(index.begin(), index.end(), 0);
+        RadixSortPairs(keys, index);
+        std::vector<T> sorted;
+        sorted.reserve(n);
+        for (size_t i: index) {
+            sorted.push_back(std::move(begin[i]));
+        }
+        std::move(sorted.begin(), sorted.end(), begin);
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+constexpr std::ptrdiff_t kAmericanFlagSortThreshold = 64;
+constexpr std::ptrdiff_t kStringInsertionSortThreshold = 10;
+
+// Keys are read through char_at(element, depth), which returns 0 past the end of the key and
+// the unsigned byte plus one otherwise.
+struct StringCharAt {
+    int operator()(const std::string &string, size_t depth) const {
+        return depth < string.size() ? static_cast<unsigned char>(string.data()[depth]) + 1 : 0;
+    }
+    int operator()(std::string_view string, size_t depth) const {
+        return depth < string.size() ? static_cast<unsigned char>(string.data()[depth]) + 1 : 0;
+    }
+    template<class String>
+    int operator()(const String &string, size_t depth) const {
+        return (*this)(std::string_view(string), depth);
+    }
+};
+
+// First depth at or after level where two keys of [begin, end) differ or all of them end.
+template<class Iterator, class CharAt>
+size_t CommonPrefixEnd(Iterator begin, Iterator end, size_t level, CharAt char_at) {
+    size_t limit = static_cast<size_t>(-1);
+    for (Iterator it = begin + 1; it != end; ++it) {
+        size_t depth = level;
+        while (depth < limit) {
+            int current = char_at(*begin, depth);
+            if (current != char_at(*it, depth) || current == 0) {
+                break;
+            }
+            ++depth;
+        }
+        limit = depth;
+    }
+    return limit;
+}
+
+template<class T, class CharAt>
+bool StringLess(const T &first, const T &second, size_t depth, CharAt char_at) {
+    while (true) {
+        int first_char = char_at(first, depth), second_char = char_at(second, depth);
+        if (first_char != second_char) {
+            return first_char < second_char;
+        }
+        if (first_char == 0) {
+            return false;
+        }
+        ++depth;
+    }
+}
+
+template<class Iterator, class CharAt>
+void StringInsertionSort(Iterator begin, Iterator end, size_t depth, CharAt char_at) {
+    for (Iterator it = begin; it != end; ++it) {
+        for (Iterator hole = it; hole != begin && StringLess(*hole, *(hole - 1), depth, char_at); --hole) {
+            std::iter_swap(hole, hole - 1);
+        }
+    }
+}
+
+// Bentley-Sedgewick three-way radix quicksort on the character at the current depth.
+template<class Iterator, class CharAt>
+void MultikeyQuickSort(Iterator begin, Iterator end, size_t depth, CharAt char_at) {
+    while (end - begin > kStringInsertionSortThreshold) {
+        Iterator mid = begin + (end - begin) / 2;
+        int a = char_at(*begin, depth), b = char_at(*mid, depth), c = char_at(*(end - 1), depth);
+        int pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+        Iterator less = begin, it = begin, greater = end;
+        while (it < greater) {
+            int current = char_at(*it, depth);
+            if (current < pivot) {
+                std::iter_swap(less++, it++);
+            } else if (current > pivot) {
+                std::iter_swap(it, --greater);
+            } else {
+                ++it;
+            }
+        }
+        MultikeyQuickSort(begin, less, depth, char_at);
+        MultikeyQuickSort(greater, end, depth, char_at);
+        if (pivot == 0) {
+            return;
+        }
+        begin = less;
+        end = greater;
+        ++depth;
+    }
+    StringInsertionSort(begin, end, depth, char_at);
+}
+
+// In-place MSD radix sort (American flag sort) with 257 buckets per level; buckets below
+// kAmericanFlagSortThreshold elements are finished by multikey quicksort. Pending buckets are
+// kept on an explicit stack, so long common prefixes do not deepen the call stack. The byte of
+// every key at the current level is read once into a side array that the counting and permuting
+// passes share, and a level where all keys fall into one bucket skips the whole common prefix with
+// one scan of every key instead of one counting pass per shared byte.
+template<class Iterator, class CharAt>
+void AmericanFlagSort(Iterator begin, Iterator end, CharAt char_at, size_t depth = 0) {
+    struct Bucket {
+        Iterator begin;
+        Iterator end;
+        size_t depth;
+    };
+    std::vector<Bucket> stack{{begin, end, depth}};
+    std::vector<std::ptrdiff_t> count(257), next(257), limit(257);
+    std::vector<uint16_t> bytes(end - begin);
+    while (!stack.empty()) {
+        auto [first, last, level] = stack.back();
+        stack.pop_back();
+        const std::ptrdiff_t size = last - first;
+        if (size < kAmericanFlagSortThreshold) {
+            MultikeyQuickSort(first, last, level, char_at);
+            continue;
+        }
+        uint16_t *key = bytes.data() + (first - begin);
+        count.assign(257, 0);
+        for (std::ptrdiff_t i = 0; i < size; ++i) {
+            key[i] = static_cast<uint16_t>(char_at(first[i], level));
+            ++count[key[i]];
+        }
+        if (count[key[0]] == size) {
+            if (key[0] != 0) {
+                stack.push_back({first, last, CommonPrefixEnd(first, last, level + 1, char_at)});
+            }
+            continue;
+        }
+        std::ptrdiff_t sum = 0;
+        for (int bucket = 0; bucket < 257; ++bucket) {
+            next[bucket] = sum;
+            sum += count[bucket];
+            limit[bucket] = sum;
+        }
+        for (int bucket = 0; bucket < 257; ++bucket) {
+            while (next[bucket] < limit[bucket]) {
+                std::ptrdiff_t position = next[bucket];
+                int current = key[position];
+                while (current != bucket) {
+                    std::ptrdiff_t target = next[current]++;
+                    std::iter_swap(first + position, first + target);
+                    current = key[target];
+                }
+                ++next[bucket];
+            }
+        }
+        for (int bucket = 256; bucket > 0; --bucket) {
+            if (count[bucket] > 1) {
+                stack.push_back({first + limit[bucket] - count[bucket], first + limit[bucket], level + 1});
+            }
+        }
+    }
+}
+
+// Sorts std::string, std::string_view or anything convertible to std::string_view by bytes.
+template<class Iterator>
+void StringSort(Iterator begin, Iterator end) {
+    AmericanFlagSort(begin, end, StringCharAt());
+}
@@ -2,6 +2,12 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <algorithm>
+
+#include "../Sort/StringSort.h"
+
+constexpr size_t kInitialPrefixLength = 8;
 
 void CountingSort(std::vector<size_t> &array, std::vector<size_t> &classes, size_t max_element) {
     std::vector<size_t> copy = array;
@@ -18,22 +24,39 @@ void CountingSort(std::vector<size_t> &array, std::vector<size_t> &classes, size
 }
 
 std::vector<size_t> GetCycleSort(const std::string &string) {
+    if (string.empty()) {
+        return {};
+    }
+    const size_t prefix = std::min(kInitialPrefixLength, string.size());
+    auto char_at = [&](size_t position, size_t depth) {
+        if (depth >= prefix) {
+            return 0;
+        }
+        position += depth;
+        if (position >= string.size()) {
+            position -= string.size();
+        }
+        return static_cast<unsigned char>(string[position]) + 1;
+    };
     std::vector<size_t> positions(string.size());
     std::vector<size_t> classes(string.size());
     for (size_t i = 0; i < string.size(); ++i) {
         positions[i] = i;
-        classes[i] = string[i] - 'a';
     }
-    CountingSort(positions, classes, 26);
+    AmericanFlagSort(positions.begin(), positions.end(), char_at);
     size_t current_class = classes[positions[0]] = 0;
     for (size_t i = 1; i < positions.size(); ++i) {
-        if (string[positions[i]] != string[positions[i - 1]]) {
-            ++current_class;
+        for (size_t depth = 0; depth < prefix; ++depth) {
+            if (char_at(positions[i], depth) != char_at(positions[i - 1], depth)) {
+                ++current_class;
+                break;
+            }
         }
         classes[positions[i]] = current_class;
     }
 
-    for (size_t pow = 1; pow < positions.size(); pow <<= 1) {
+    // Once every class holds a single shift the order is final and further doubling changes nothing.
+    for (size_t pow = prefix; pow < positions.size() && current_class + 1 < positions.size(); pow <<= 1) {
         for (size_t i = 0; i < positions.size(); ++i) {
             if (positions[i] < pow) {
                 positions[i] += positions.size();
@@ -1,13 +1,7 @@
 #pragma once
 
-#include <iostream>
 #include <vector>
 
-#include <map>
-#include <unordered_map>
-#include <windows.h>
-#include <random>
-
 // Map <UIntMax, UIntMax - 1>; on average 384 bites for
 template <template <typename> class allocator = std::allocator>
 class TrieMapUInt {
@@ -58,7 +52,7 @@ public:
     }
 
     bool has(unsigned int key) {
-        return get(key) != -1;
+        return get(key) != static_cast<unsigned int>(-1);
     }
 
 
@@ -75,34 +69,3 @@ private:
 
     std::vector<node, allocator<node>> nodes;
 };
-
-std::mt19937 rnd(42);
-
-void test_trie(int n) {
-    TrieMapUInt<> map;
-    for (int i = 0; i < n; ++i) {
-        map.set(rnd(), rnd());
-    }
-    for (int i = 0; i < n; ++i) {
-        map.get(rnd());
-    }
-}
-
-void test_map(int n) {
-    std::unordered_map<unsigned int, unsigned int> map;
-    for (int i = 0; i < n; ++i) {
-        map.insert({rnd(), rnd()});
-    }
-    for (int i = 0; i < n; ++i) {
-        map[rnd()];
-    }
-}
-
-int main() {
-    long long current_time = GetTickCount();
-
-    //test_map(1000000);
-    test_trie(1000000);
-
-    std::cout << GetTickCount() - current_time;
-}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Finalizer of MurmurHash3: every input bit affects every output bit, so identity hashes of
+// integers spread over the low bits used by masking and the high bits used by fastrange.
+inline size_t MixHash(size_t hash) {
+    uint64_t x = hash;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+}
+
+// High 64 bits of the 128-bit product a * b.
+inline uint64_t MulHigh64(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+    uint64_t a_lo = a & 0xffffffffu, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xffffffffu, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffu) + lo_hi;
+    return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+// A bucket policy decides how many buckets a table really gets for a requested count (bucket_count),
+// how a user hash is transformed before it is stored in a node (mix) and which bucket a stored hash
+// falls into (index).
+
+// Power-of-two bucket counts, the bucket is chosen by masking the mixed hash.
+struct PowerOfTwoBucketPolicy {
+    static size_t bucket_count(size_t count) {
+        size_t result = 1;
+        while (result < count) {
+            result <<= 1;
+        }
+        return result;
+    }
+    static size_t mix(size_t hash) {
+        return MixHash(hash);
+    }
+    static size_t index(size_t hash, size_t count) {
+        return hash & (count - 1);
+    }
+};
+
+// Any bucket count, the bucket is the high half of the product of the mixed hash and the count.
+struct FastRangeBucketPolicy {
+    static size_t bucket_count(size_t count) {
+        return count ? count : 1;
+    }
+    static size_t mix(size_t hash) {
+        return MixHash(hash);
+    }
+    static size_t index(size_t hash, size_t count) {
+        if constexpr (sizeof(size_t) <= sizeof(uint32_t)) {
+            return static_cast<size_t>((static_cast<uint64_t>(hash) * count) >> 32);
+        } else {
+            return static_cast<size_t>(MulHigh64(hash, count));
+        }
+    }
+};
+
+// The raw hash modulo the bucket count.
+struct ModuloBucketPolicy {
+    static size_t bucket_count(size_t count) {
+        return count ? count : 1;
+    }
+    static size_t mix(size_t hash) {
+        return hash;
+    }
+    static size_t index(size_t hash, size_t count) {
+        return hash % count;
+    }
+};
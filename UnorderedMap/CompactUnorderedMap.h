@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BucketPolicy.h"
+
+// Keys hashed by std::hash in a few instructions: recomputing such a hash is cheaper than the four
+// bytes per element it would take to store it.
+template<typename Key, typename Hash>
+struct IsCheapHash : std::bool_constant<std::is_same_v<Hash, std::hash<Key> > &&
+                                        (std::is_arithmetic_v<Key> || std::is_enum_v<Key> ||
+                                         std::is_pointer_v<Key>)> {
+};
+
+// Memory-lean UnorderedMap: elements live densely in one array and are chained through 32-bit
+// indices, a bucket is a single 32-bit index of its first element and the low 32 bits of the mixed
+// hash are kept per element only when StoreHash is set. A pair<int, int> costs 12 bytes plus one or
+// two bucket slots. Erasure moves the last element into the freed slot, so erasing invalidates
+// iterators to the last element and element order is unspecified. Unlike UnorderedMap the key in
+// NodeType is not const and must not be modified through an iterator. At most 2^32 - 1 elements
+// and 2^32 buckets. entries is a std::vector, so every growth moves all elements and briefly holds
+// the old and the new array, about twice the memory of the elements; reserve() up front avoids both.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+        typename Alloc = std::allocator<std::pair<Key, Value> >, bool StoreHash = !IsCheapHash<Key, Hash>::value>
+class CompactUnorderedMap {
+public:
+    using NodeType = std::pair<Key, Value>;
+
+private:
+    static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t kMinBuckets = 16;
+    // Buckets are chosen by the low 32 bits of the mixed hash, the part kept in entries.
+    static constexpr size_t kMaxBuckets =
+            static_cast<size_t>(std::min<uint64_t>(uint64_t(1) << 32, std::numeric_limits<size_t>::max() / 2 + 1));
+
+    template<bool Hashed, typename = void>
+    struct entry {
+        NodeType data;
+        uint32_t next;
+
+        template<typename... Args>
+        entry(uint32_t, Args &&... args) : data(std::forward<Args>(args)...), next(kNone) {}
+        uint32_t hash() const {
+            return 0;
+        }
+    };
+
+    template<typename Dummy>
+    struct entry<true, Dummy> {
+        NodeType data;
+        uint32_t next;
+        uint32_t hsh;
+
+        template<typename... Args>
+        entry(uint32_t hsh_, Args &&... args) : data(std::forward<Args>(args)...), next(kNone), hsh(hsh_) {}
+        uint32_t hash() const {
+            return hsh;
+        }
+    };
+
+    using Entry = entry<StoreHash>;
+
+    // A pair whose first member is a Key, which emplace_ can look up without building a node.
+    template<typename T>
+    struct is_key_pair_ : std::false_type {
+    };
+
+    template<typename First, typename Second>
+    struct is_key_pair_<std::pair<First, Second> > : std::is_same<std::remove_const_t<First>, Key> {
+    };
+
+    template<typename A>
+    using common_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<A>;
+
+    std::vector<Entry, common_allocator<Entry> > entries;
+    std::vector<uint32_t, common_allocator<uint32_t> > heads;
+    float max_load = 1;
+    Hash hash;
+    Equal equal;
+
+public:
+    CompactUnorderedMap(const Alloc &alloc = Alloc()) : entries(alloc), heads(alloc) {}
+
+    Alloc get_allocator() const {
+        return entries.get_allocator();
+    }
+
+    template<bool IsConst>
+    struct common_iterator {
+        friend common_iterator<false>;
+        friend common_iterator<true>;
+        friend CompactUnorderedMap;
+
+    private:
+        using T_ = std::conditional_t<IsConst, const NodeType, NodeType>;
+        using E_ = std::conditional_t<IsConst, const Entry, Entry>;
+        E_ *ptr;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T_;
+        using pointer = T_ *;
+        using reference = T_ &;
+
+        common_iterator() : ptr(nullptr) {}
+        common_iterator(E_ *ptr_) : ptr(ptr_) {}
+
+        operator common_iterator<true>() const {
+            return common_iterator<true>(ptr);
+        }
+        T_ &operator*() const {
+            return ptr->data;
+        }
+        T_ *operator->() const {
+            return &ptr->data;
+        }
+        common_iterator &operator++() {
+            ++ptr;
+            return *this;
+        }
+        common_iterator operator++(int) {
+            common_iterator result = *this;
+            ++*this;
+            return result;
+        }
+        bool operator==(const common_iterator<true> &other) const {
+            return ptr == other.ptr;
+        }
+        bool operator==(const common_iterator<false> &other) const {
+            return ptr == other.ptr;
+        }
+        bool operator!=(const common_iterator<true> &other) const {
+            return !(*this == other);
+        }
+        bool operator!=(const common_iterator<false> &other) const {
+            return !(*this == other);
+        }
+    };
+    using iterator = common_iterator<false>;
+    using const_iterator = common_iterator<true>;
+
+    iterator begin() {
+        return iterator(entries.data());
+    }
+    iterator end() {
+        return iterator(entries.data() + entries.size());
+    }
+    const_iterator begin() const {
+        return const_iterator(entries.data());
+    }
+    const_iterator end() const {
+        return const_iterator(entries.data() + entries.size());
+    }
+    const_iterator cbegin() const {
+        return begin();
+    }
+    const_iterator cend() const {
+        return end();
+    }
+
+    Value &operator[](const Key &key) {
+        return get_(key);
+    }
+    Value &operator[](Key &&key) {
+        return get_(std::move(key));
+    }
+    Value &at(const Key &key) {
+        return get_throw_(key);
+    }
+    const Value &at(const Key &key) const {
+        return const_cast<CompactUnorderedMap *>(this)->get_throw_(key);
+    }
+    size_t size() const {
+        return entries.size();
+    }
+    bool empty() const {
+        return entries.empty();
+    }
+    size_t bucket_count() const {
+        return heads.size();
+    }
+    iterator find(const Key &key) {
+        return iterator_at_(find_(key, hash_(key)));
+    }
+    const_iterator find(const Key &key) const {
+        return const_cast<CompactUnorderedMap *>(this)->find(key);
+    }
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args) {
+        return emplace_(std::forward<Args>(args)...);
+    }
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        while (first != last) {
+            emplace_(*first);
+            ++first;
+        }
+    }
+    template<typename Node>
+    std::pair<iterator, bool> insert(Node &&data) {
+        return emplace_(std::forward<Node>(data));
+    }
+    std::pair<iterator, bool> insert(NodeType &&data) {
+        return emplace_(std::move(data));
+    }
+    void erase(const Key &key) {
+        uint32_t index = find_(key, hash_(key));
+        if (index != kNone) {
+            erase_(index);
+        }
+    }
+    // Returns an iterator to the element moved into the erased position, or end().
+    iterator erase(const_iterator it) {
+        uint32_t index = it.ptr - entries.data();
+        erase_(index);
+        return iterator(entries.data() + index);
+    }
+    void clear() {
+        entries.clear();
+        std::fill(heads.begin(), heads.end(), kNone);
+    }
+    void rehash(size_t count) {
+        rehash_(PowerOfTwoBucketPolicy::bucket_count(std::min(std::max(count, kMinBuckets), kMaxBuckets)));
+    }
+    void reserve(size_t count) {
+        entries.reserve(count);
+        size_t buckets = count / max_load_factor() + 1;
+        if (buckets > bucket_count()) {
+            rehash(buckets);
+        }
+    }
+    float load_factor() const {
+        return heads.empty() ? 0 : 1.0 * size() / bucket_count();
+    }
+    float max_load_factor() const {
+        return max_load;
+    }
+    void max_load_factor(float ml) {
+        max_load = ml;
+    }
+
+private:
+    size_t hash_(const Key &key) const {
+        return MixHash(hash(key));
+    }
+
+    size_t stored_hash_(const Entry &item) const {
+        if constexpr (StoreHash) {
+            return item.hash();
+        } else {
+            return hash_(item.data.first);
+        }
+    }
+
+    uint32_t &head_(size_t hsh) {
+        return heads[static_cast<uint32_t>(hsh) & (heads.size() - 1)];
+    }
+
+    iterator iterator_at_(uint32_t index) {
+        return index == kNone ? end() : iterator(entries.data() + index);
+    }
+
+    uint32_t find_(const Key &key, size_t hsh) {
+        if (heads.empty()) {
+            return kNone;
+        }
+        for (uint32_t index = head_(hsh); index != kNone; index = entries[index].next) {
+            const Entry &item = entries[index];
+            if ((!StoreHash || item.hash() == static_cast<uint32_t>(hsh)) && equal(item.data.first, key)) {
+                return index;
+            }
+        }
+        return kNone;
+    }
+
+    void rehash_(size_t count) {
+        heads.assign(count, kNone);
+        for (uint32_t index = 0; index < entries.size(); ++index) {
+            uint32_t &head = head_(stored_hash_(entries[index]));
+            entries[index].next = head;
+            head = index;
+        }
+    }
+
+    // Links the last element of entries into its bucket, growing the table first when needed.
+    void link_last_(size_t hsh) {
+        if (entries.size() > bucket_count() * max_load_factor() && bucket_count() < kMaxBuckets) {
+            rehash(std::max(2 * bucket_count(), size_t(entries.size() / max_load_factor()) + 1));
+            return;
+        }
+        uint32_t &head = head_(hsh);
+        entries.back().next = head;
+        head = entries.size() - 1;
+    }
+
+    void check_capacity_() {
+        if (entries.size() >= kNone) {
+            throw std::length_error("CompactUnorderedMap holds at most 2^32 - 1 elements");
+        }
+    }
+
+    template<typename NodeKey>
+    Value &get_(NodeKey &&key) {
+        size_t hsh = hash_(key);
+        uint32_t index = find_(key, hsh);
+        if (index != kNone) {
+            return entries[index].data.second;
+        }
+        check_capacity_();
+        entries.emplace_back(static_cast<uint32_t>(hsh), std::piecewise_construct,
+                             std::forward_as_tuple(std::forward<NodeKey>(key)), std::forward_as_tuple());
+        link_last_(hsh);
+        return entries.back().data.second;
+    }
+
+    Value &get_throw_(const Key &key) {
+        uint32_t index = find_(key, hash_(key));
+        if (index == kNone) {
+            throw std::out_of_range("the container does not have an element with the specified key");
+        }
+        return entries[index].data.second;
+    }
+
+    // The key is looked up before entries grows, so emplacing a present key moves nothing: a ready
+    // pair supplies its key directly, any other arguments are first built into a temporary.
+    template<typename... Args>
+    std::pair<iterator, bool> emplace_(Args &&... args) {
+        if constexpr (sizeof...(Args) == 1 && (is_key_pair_<std::decay_t<Args> >::value && ...)) {
+            return place_(args.first..., std::forward<Args>(args)...);
+        } else {
+            NodeType node(std::forward<Args>(args)...);
+            return place_(node.first, std::move(node));
+        }
+    }
+
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> place_(const K &key, Args &&... args) {
+        size_t hsh = hash_(key);
+        uint32_t index = find_(key, hsh);
+        if (index != kNone) {
+            return {iterator(entries.data() + index), false};
+        }
+        check_capacity_();
+        entries.emplace_back(static_cast<uint32_t>(hsh), std::forward<Args>(args)...);
+        link_last_(hsh);
+        return {iterator(&entries.back()), true};
+    }
+
+    // Points link at the chain slot holding index, starting from the bucket of hsh.
+    uint32_t *link_to_(uint32_t index, size_t hsh) {
+        uint32_t *link = &head_(hsh);
+        while (*link != index) {
+            link = &entries[*link].next;
+        }
+        return link;
+    }
+
+    void erase_(uint32_t index) {
+        *link_to_(index, stored_hash_(entries[index])) = entries[index].next;
+        uint32_t last = entries.size() - 1;
+        if (index != last) {
+            *link_to_(last, stored_hash_(entries[last])) = index;
+            entries[index] = std::move(entries[last]);
+        }
+        entries.pop_back();
+    }
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "UnorderedMap.h"
+
+// UnorderedMap split into a power-of-two number of shards, each behind its own reader-writer lock
+// on its own cache line. The shard is picked by the top bits of the mixed hash, the bucket inside
+// the shard by the low ones, and the hash is computed once and passed down. Readers of one shard
+// share its lock; a lock-free read is not offered because writers free nodes and bucket arrays that
+// a reader could still be walking. Lookups return copies, since references would outlive the lock.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+        typename Alloc = std::allocator<std::pair<const Key, Value> > >
+class ConcurrentUnorderedMap {
+    using Map = UnorderedMap<Key, Value, Hash, Equal, Alloc>;
+    static constexpr int kHashBits = sizeof(size_t) * CHAR_BIT;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        Map map;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shard_count;
+    int shard_shift;
+    Hash hash;
+
+public:
+    // shards == 0 picks four shards per hardware thread.
+    explicit ConcurrentUnorderedMap(size_t shards_ = 0) {
+        if (shards_ == 0) {
+            shards_ = 4 * std::max(1u, std::thread::hardware_concurrency());
+        }
+        shard_count = 1;
+        shard_shift = kHashBits;
+        while (shard_count < shards_) {
+            shard_count <<= 1;
+            --shard_shift;
+        }
+        shards.reset(new Shard[shard_count]);
+    }
+    ConcurrentUnorderedMap(const ConcurrentUnorderedMap &) = delete;
+    ConcurrentUnorderedMap &operator=(const ConcurrentUnorderedMap &) = delete;
+
+    std::optional<Value> find(const Key &key) const {
+        size_t hsh = hash(key);
+        const Shard &shard = shard_(hsh);
+        std::shared_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hsh);
+        if (it == shard.map.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+    bool contains(const Key &key) const {
+        size_t hsh = hash(key);
+        const Shard &shard = shard_(hsh);
+        std::shared_lock lock(shard.mutex);
+        return shard.map.find(key, hsh) != shard.map.end();
+    }
+    // Returns false and leaves the map unchanged when key is already present.
+    template<typename... Args>
+    bool emplace(const Key &key, Args &&... args) {
+        size_t hsh = hash(key);
+        Shard &shard = shard_(hsh);
+        std::unique_lock lock(shard.mutex);
+        if (shard.map.find(key, hsh) != shard.map.end()) {
+            return false;
+        }
+        shard.map.emplace_hint_hash(hsh, std::piecewise_construct, std::forward_as_tuple(key),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+        return true;
+    }
+    // Returns true when key was inserted, false when an existing value was overwritten.
+    template<typename V>
+    bool insert_or_assign(const Key &key, V &&value) {
+        size_t hsh = hash(key);
+        Shard &shard = shard_(hsh);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hsh);
+        if (it != shard.map.end()) {
+            it->second = std::forward<V>(value);
+            return false;
+        }
+        shard.map.emplace_hint_hash(hsh, key, std::forward<V>(value));
+        return true;
+    }
+    // Calls function(value) under the shard's exclusive lock, with value default-constructed first
+    // when key is absent, and returns a copy of what function returns: a reference would outlive the lock.
+    template<typename Function>
+    std::decay_t<std::invoke_result_t<Function &, Value &> > compute(const Key &key, Function function) {
+        size_t hsh = hash(key);
+        Shard &shard = shard_(hsh);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hsh);
+        if (it == shard.map.end()) {
+            it = shard.map.emplace_hint_hash(hsh, key, Value()).first;
+        }
+        return function(it->second);
+    }
+    bool erase(const Key &key) {
+        size_t hsh = hash(key);
+        Shard &shard = shard_(hsh);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hsh);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        shard.map.erase(it);
+        return true;
+    }
+    // Visits the shards one at a time under their shared locks, so the whole map is not a snapshot.
+    template<typename Function>
+    void for_each(Function function) const {
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::shared_lock lock(shards[i].mutex);
+            for (const auto &item: shards[i].map) {
+                function(item);
+            }
+        }
+    }
+    size_t size() const {
+        size_t result = 0;
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::shared_lock lock(shards[i].mutex);
+            result += shards[i].map.size();
+        }
+        return result;
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+    void clear() {
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::unique_lock lock(shards[i].mutex);
+            shards[i].map.clear();
+        }
+    }
+    void reserve(size_t count) {
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::unique_lock lock(shards[i].mutex);
+            shards[i].map.reserve(count / shard_count + 1);
+        }
+    }
+
+private:
+    Shard &shard_(size_t hsh) const {
+        return shards[shard_shift == kHashBits ? 0 : MixHash(hsh) >> shard_shift];
+    }
+};
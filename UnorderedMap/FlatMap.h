@@ -0,0 +1,504 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAT_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "BucketPolicy.h"
+
+// Open-addressing hash map in the style of Swiss tables, with the interface of UnorderedMap.
+// Every slot has a control byte holding either a 7-bit fingerprint of the hash (H2) or an
+// empty/deleted marker; lookups start at the group chosen by the rest of the hash (H1) and
+// compare the fingerprints of 16 slots at a time before touching any key. Values live inline in
+// one slot array, the capacity is a power of two and indices are masked.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+        typename Alloc = std::allocator<std::pair<const Key, Value> > >
+class FlatMap {
+public:
+    using NodeType = std::pair<const Key, Value>;
+
+private:
+    using ctrl_t = int8_t;
+    static constexpr ctrl_t kEmpty = -128;
+    static constexpr ctrl_t kDeleted = -2;
+    static constexpr size_t kGroupWidth = 16;
+
+    using AllocTraits = std::allocator_traits<Alloc>;
+
+    // Bit i of a mask is set when slot (group start + i) matches.
+    struct Group {
+#ifdef FLAT_MAP_SSE2
+        __m128i ctrl;
+
+        explicit Group(const ctrl_t *pos) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos))) {}
+
+        uint32_t Match(ctrl_t h2) const {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+        }
+        uint32_t MatchEmpty() const {
+            return Match(kEmpty);
+        }
+        uint32_t MatchEmptyOrDeleted() const {
+            return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+        }
+#else
+        ctrl_t ctrl[kGroupWidth];
+
+        explicit Group(const ctrl_t *pos) {
+            std::memcpy(ctrl, pos, kGroupWidth);
+        }
+
+        uint32_t Match(ctrl_t h2) const {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; ++i) {
+                mask |= uint32_t(ctrl[i] == h2) << i;
+            }
+            return mask;
+        }
+        uint32_t MatchEmpty() const {
+            return Match(kEmpty);
+        }
+        uint32_t MatchEmptyOrDeleted() const {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; ++i) {
+                mask |= uint32_t(ctrl[i] < -1) << i;
+            }
+            return mask;
+        }
+#endif
+    };
+
+    // mask is never zero.
+    static size_t LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    static size_t H1(size_t hash) {
+        return hash >> 7;
+    }
+    static ctrl_t H2(size_t hash) {
+        return static_cast<ctrl_t>(hash & 0x7f);
+    }
+
+    Alloc alloc;
+    std::vector<ctrl_t> ctrl;
+    NodeType *slots = nullptr;
+    size_t capacity = 0;
+    size_t sz = 0;
+    size_t deleted = 0;
+    float max_load = 0.875;
+    Hash hash;
+    Equal equal;
+
+public:
+    FlatMap(const Alloc &alloc_ = Alloc()) : alloc(alloc_) {}
+    FlatMap(const FlatMap &other)
+            : alloc(AllocTraits::select_on_container_copy_construction(other.alloc)), max_load(other.max_load),
+              hash(other.hash), equal(other.equal) {
+        reserve(other.size());
+        for (const auto &item: other) {
+            emplace_(item);
+        }
+    }
+    FlatMap(FlatMap &&other)
+            : alloc(std::move(other.alloc)), ctrl(std::move(other.ctrl)), slots(other.slots),
+              capacity(other.capacity), sz(other.sz), deleted(other.deleted), max_load(other.max_load),
+              hash(std::move(other.hash)), equal(std::move(other.equal)) {
+        other.release_();
+    }
+    ~FlatMap() {
+        destroy_();
+    }
+    FlatMap &operator=(const FlatMap &other) {
+        if (this != &other) {
+            FlatMap copy(other);
+            swap_(copy);
+        }
+        return *this;
+    }
+    FlatMap &operator=(FlatMap &&other) {
+        if (this != &other) {
+            destroy_();
+            alloc = std::move(other.alloc);
+            ctrl = std::move(other.ctrl);
+            slots = other.slots;
+            capacity = other.capacity;
+            sz = other.sz;
+            deleted = other.deleted;
+            max_load = other.max_load;
+            hash = std::move(other.hash);
+            equal = std::move(other.equal);
+            other.release_();
+        }
+        return *this;
+    }
+    Alloc get_allocator() const {
+        return alloc;
+    }
+
+    template<bool IsConst>
+    struct common_iterator {
+        friend common_iterator<false>;
+        friend common_iterator<true>;
+        friend FlatMap;
+
+    private:
+        using T_ = std::conditional_t<IsConst, const NodeType, NodeType>;
+        const ctrl_t *ctrl_;
+        NodeType *slot_;
+        const ctrl_t *end_;
+
+        void skip_() {
+            while (ctrl_ != end_ && *ctrl_ < 0) {
+                ++ctrl_;
+                ++slot_;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T_;
+        using pointer = T_ *;
+        using reference = T_ &;
+
+        common_iterator() : ctrl_(nullptr), slot_(nullptr), end_(nullptr) {}
+        common_iterator(const ctrl_t *ctrl_pos, NodeType *slot, const ctrl_t *end)
+                : ctrl_(ctrl_pos), slot_(slot), end_(end) {}
+
+        operator common_iterator<true>() const {
+            return common_iterator<true>(ctrl_, slot_, end_);
+        }
+        T_ &operator*() const {
+            return *slot_;
+        }
+        T_ *operator->() const {
+            return slot_;
+        }
+        common_iterator &operator++() {
+            ++ctrl_;
+            ++slot_;
+            skip_();
+            return *this;
+        }
+        common_iterator operator++(int) {
+            common_iterator result = *this;
+            ++*this;
+            return result;
+        }
+        bool operator==(const common_iterator<true> &other) const {
+            return ctrl_ == other.ctrl_;
+        }
+        bool operator==(const common_iterator<false> &other) const {
+            return ctrl_ == other.ctrl_;
+        }
+        bool operator!=(const common_iterator<true> &other) const {
+            return !(*this == other);
+        }
+        bool operator!=(const common_iterator<false> &other) const {
+            return !(*this == other);
+        }
+    };
+    using iterator = common_iterator<false>;
+    using const_iterator = common_iterator<true>;
+
+    iterator begin() {
+        iterator it = iterator_at_(0);
+        it.skip_();
+        return it;
+    }
+    iterator end() {
+        return iterator_at_(capacity);
+    }
+    const_iterator begin() const {
+        return const_cast<FlatMap *>(this)->begin();
+    }
+    const_iterator end() const {
+        return const_cast<FlatMap *>(this)->end();
+    }
+    const_iterator cbegin() const {
+        return begin();
+    }
+    const_iterator cend() const {
+        return end();
+    }
+
+    Value &operator[](const Key &key) {
+        return try_emplace_(key).first->second;
+    }
+    Value &operator[](Key &&key) {
+        return try_emplace_(std::move(key)).first->second;
+    }
+    Value &at(const Key &key) {
+        return at_(key);
+    }
+    const Value &at(const Key &key) const {
+        return const_cast<FlatMap *>(this)->at_(key);
+    }
+    size_t size() const {
+        return sz;
+    }
+    bool empty() const {
+        return sz == 0;
+    }
+    size_t bucket_count() const {
+        return capacity;
+    }
+    iterator find(const Key &key) {
+        return iterator_at_(find_(key));
+    }
+    const_iterator find(const Key &key) const {
+        return const_cast<FlatMap *>(this)->find(key);
+    }
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args) {
+        return emplace_(std::forward<Args>(args)...);
+    }
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        while (first != last) {
+            emplace_(*first);
+            ++first;
+        }
+    }
+    template<typename Node>
+    std::pair<iterator, bool> insert(Node &&data) {
+        return emplace_(std::forward<Node>(data));
+    }
+    std::pair<iterator, bool> insert(NodeType &&data) {
+        return emplace_(std::move(data));
+    }
+    void erase(const Key &key) {
+        size_t index = find_(key);
+        if (index != capacity) {
+            erase_at_(index);
+        }
+    }
+    void erase(const_iterator it) {
+        erase_at_(it.slot_ - slots);
+    }
+    void erase(const_iterator first, const_iterator last) {
+        while (first != last) {
+            const_iterator current = first++;
+            erase_at_(current.slot_ - slots);
+        }
+    }
+    void clear() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0) {
+                AllocTraits::destroy(alloc, slots + i);
+            }
+        }
+        std::fill(ctrl.begin(), ctrl.end(), kEmpty);
+        sz = 0;
+        deleted = 0;
+    }
+    void rehash(size_t count) {
+        size_t new_capacity = kGroupWidth;
+        while (new_capacity < count || new_capacity * max_load < sz + 1) {
+            new_capacity <<= 1;
+        }
+        rehash_(new_capacity);
+    }
+    void reserve(size_t count) {
+        rehash(count / max_load_factor() + 1);
+    }
+    float load_factor() const {
+        return capacity ? 1.0 * size() / capacity : 0;
+    }
+    float max_load_factor() const {
+        return max_load;
+    }
+    void max_load_factor(float ml) {
+        max_load = std::min(ml, 0.875f);
+    }
+
+private:
+    iterator iterator_at_(size_t index) {
+        return iterator(ctrl.data() + index, slots + index, ctrl.data() + capacity);
+    }
+
+    void set_ctrl_(size_t index, ctrl_t value) {
+        ctrl[index] = value;
+        if (index < kGroupWidth) {
+            ctrl[capacity + index] = value;
+        }
+    }
+
+    template<typename K>
+    size_t find_(const K &key) const {
+        return sz == 0 ? capacity : find_(key, MixHash(hash(key)));
+    }
+
+    template<typename K>
+    size_t find_(const K &key, size_t hsh) const {
+        if (sz == 0) {
+            return capacity;
+        }
+        const size_t mask = capacity - 1;
+        const ctrl_t h2 = H2(hsh);
+        size_t offset = H1(hsh) & mask;
+        for (size_t step = kGroupWidth;; step += kGroupWidth) {
+            Group group(ctrl.data() + offset);
+            for (uint32_t match = group.Match(h2); match; match &= match - 1) {
+                size_t index = (offset + LowestBit(match)) & mask;
+                if (equal(slots[index].first, key)) {
+                    return index;
+                }
+            }
+            if (group.MatchEmpty()) {
+                return capacity;
+            }
+            offset = (offset + step) & mask;
+        }
+    }
+
+    size_t find_free_(size_t hsh) const {
+        const size_t mask = capacity - 1;
+        size_t offset = H1(hsh) & mask;
+        for (size_t step = kGroupWidth;; step += kGroupWidth) {
+            uint32_t free = Group(ctrl.data() + offset).MatchEmptyOrDeleted();
+            if (free) {
+                return (offset + LowestBit(free)) & mask;
+            }
+            offset = (offset + step) & mask;
+        }
+    }
+
+    void release_() {
+        ctrl.clear();
+        slots = nullptr;
+        capacity = sz = deleted = 0;
+    }
+
+    void destroy_() {
+        if (slots != nullptr) {
+            clear();
+            AllocTraits::deallocate(alloc, slots, capacity);
+        }
+        release_();
+    }
+
+    void swap_(FlatMap &other) {
+        std::swap(alloc, other.alloc);
+        ctrl.swap(other.ctrl);
+        std::swap(slots, other.slots);
+        std::swap(capacity, other.capacity);
+        std::swap(sz, other.sz);
+        std::swap(deleted, other.deleted);
+        std::swap(max_load, other.max_load);
+        std::swap(hash, other.hash);
+        std::swap(equal, other.equal);
+    }
+
+    void rehash_(size_t new_capacity) {
+        std::vector<ctrl_t> old_ctrl(new_capacity + kGroupWidth, kEmpty);
+        old_ctrl.swap(ctrl);
+        NodeType *old_slots = slots;
+        size_t old_capacity = capacity;
+        slots = AllocTraits::allocate(alloc, new_capacity);
+        capacity = new_capacity;
+        deleted = 0;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] >= 0) {
+                size_t hsh = MixHash(hash(old_slots[i].first));
+                size_t index = find_free_(hsh);
+                // The old slot is destroyed right after, so its const key can be moved from as well.
+                AllocTraits::construct(alloc, slots + index, std::piecewise_construct,
+                                       std::forward_as_tuple(std::move(const_cast<Key &>(old_slots[i].first))),
+                                       std::forward_as_tuple(std::move(old_slots[i].second)));
+                set_ctrl_(index, H2(hsh));
+                AllocTraits::destroy(alloc, old_slots + i);
+            }
+        }
+        if (old_slots != nullptr) {
+            AllocTraits::deallocate(alloc, old_slots, old_capacity);
+        }
+    }
+
+    void fix_table_() {
+        if (capacity == 0) {
+            rehash_(kGroupWidth);
+        } else if (sz + deleted + 1 > capacity * max_load) {
+            rehash_(sz + 1 > capacity * max_load / 2 ? capacity * 2 : capacity);
+        }
+    }
+
+    void mark_full_(size_t index, size_t hsh) {
+        if (ctrl[index] == kDeleted) {
+            --deleted;
+        }
+        set_ctrl_(index, H2(hsh));
+        ++sz;
+    }
+
+    // Looks key up first and grows the table only when the element is really added, so a present
+    // key leaves every iterator valid; the element is constructed from args straight in its slot.
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> place_(const K &key, Args &&... args) {
+        const size_t hsh = MixHash(hash(key));
+        size_t index = find_(key, hsh);
+        if (index != capacity) {
+            return {iterator_at_(index), false};
+        }
+        fix_table_();
+        index = find_free_(hsh);
+        AllocTraits::construct(alloc, slots + index, std::forward<Args>(args)...);
+        mark_full_(index, hsh);
+        return {iterator_at_(index), true};
+    }
+
+    template<typename K>
+    std::pair<iterator, bool> try_emplace_(K &&key) {
+        return place_(key, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                      std::forward_as_tuple());
+    }
+
+    // A ready pair supplies its key directly; any other arguments are first built into a temporary.
+    template<typename... Args>
+    std::pair<iterator, bool> emplace_(Args &&... args) {
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, NodeType> && ...)) {
+            return place_(args.first..., std::forward<Args>(args)...);
+        } else {
+            std::pair<Key, Value> node(std::forward<Args>(args)...);
+            return place_(node.first, std::move(node));
+        }
+    }
+
+    Value &at_(const Key &key) {
+        size_t index = find_(key);
+        if (index == capacity) {
+            throw std::out_of_range("the container does not have an element with the specified key");
+        }
+        return slots[index].second;
+    }
+
+    void erase_at_(size_t index) {
+        AllocTraits::destroy(alloc, slots + index);
+        set_ctrl_(index, kDeleted);
+        --sz;
+        ++deleted;
+    }
+};
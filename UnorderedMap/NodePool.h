@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Hands out uninitialized T from slabs that double in size up to kMaxSlab elements. Freed
+// elements go to an intrusive free list threaded through their own storage and are reused first;
+// release() returns every slab to the allocator at once.
+template<typename T, typename Alloc = std::allocator<T> >
+class NodePool {
+    static constexpr size_t kMinSlab = 64;
+    static constexpr size_t kMaxSlab = 1 << 16;
+
+    union Slot {
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    using SlotAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>;
+    using SlotAllocTraits = std::allocator_traits<SlotAlloc>;
+
+    SlotAlloc alloc;
+    std::vector<std::pair<Slot *, size_t> > slabs;
+    Slot *free_list = nullptr;
+    Slot *cursor = nullptr;
+    Slot *slab_end = nullptr;
+
+public:
+    NodePool(const Alloc &alloc_ = Alloc()) : alloc(alloc_) {}
+    NodePool(const NodePool &) = delete;
+    NodePool(NodePool &&other)
+            : alloc(other.alloc), slabs(std::move(other.slabs)), free_list(other.free_list), cursor(other.cursor),
+              slab_end(other.slab_end) {
+        other.slabs.clear();
+        other.free_list = other.cursor = other.slab_end = nullptr;
+    }
+    NodePool &operator=(const NodePool &) = delete;
+    NodePool &operator=(NodePool &&other) {
+        if (this != &other) {
+            release();
+            alloc = other.alloc;
+            slabs = std::move(other.slabs);
+            free_list = other.free_list;
+            cursor = other.cursor;
+            slab_end = other.slab_end;
+            other.slabs.clear();
+            other.free_list = other.cursor = other.slab_end = nullptr;
+        }
+        return *this;
+    }
+    ~NodePool() {
+        release();
+    }
+
+    T *allocate() {
+        Slot *slot = free_list;
+        if (slot != nullptr) {
+            free_list = slot->next;
+        } else {
+            if (cursor == slab_end) {
+                add_slab_();
+            }
+            slot = cursor++;
+        }
+        return reinterpret_cast<T *>(slot->storage);
+    }
+
+    void deallocate(T *ptr) {
+        Slot *slot = reinterpret_cast<Slot *>(ptr);
+        slot->next = free_list;
+        free_list = slot;
+    }
+
+    void release() {
+        for (auto &slab: slabs) {
+            SlotAllocTraits::deallocate(alloc, slab.first, slab.second);
+        }
+        slabs.clear();
+        free_list = cursor = slab_end = nullptr;
+    }
+
+private:
+    void add_slab_() {
+        size_t count = slabs.empty() ? kMinSlab : std::min(slabs.back().second * 2, kMaxSlab);
+        Slot *slab = SlotAllocTraits::allocate(alloc, count);
+        slabs.emplace_back(slab, count);
+        cursor = slab;
+        slab_end = slab + count;
+    }
+};
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "BucketPolicy.h"
+
+// Hash map for workloads dominated by lookups. Readers take no lock and perform no atomic
+// read-modify-write: a lookup publishes the current epoch in the thread's own slot with a plain
+// store and a fence, walks the table with acquire loads and clears the slot. Writers are serialized
+// by a mutex and never modify a reachable node: a new value is a new node swapped into the chain,
+// and a rehash copies every node into a new bucket array and publishes it with one store. Unlinked
+// nodes and arrays are retired with the epoch of their removal and freed once no reader slot
+// holds an epoch that old. Iteration order is unspecified and there is no iterator; find returns a copy.
+// A thread's reader slot is returned to the map when the thread exits and reused by the next one.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key> >
+class ReadMostlyMap {
+    static constexpr size_t kMinBuckets = 16;
+
+    struct Node {
+        const Key key;
+        const Value value;
+        const size_t hsh;
+        std::atomic<Node *> next;
+
+        template<typename K, typename V>
+        Node(K &&key_, V &&value_, size_t hsh_, Node *next_)
+                : key(std::forward<K>(key_)), value(std::forward<V>(value_)), hsh(hsh_), next(next_) {}
+    };
+
+    struct Table {
+        size_t mask;
+        std::unique_ptr<std::atomic<Node *>[]> buckets;
+
+        explicit Table(size_t count) : mask(count - 1), buckets(new std::atomic<Node *>[count]) {
+            for (size_t i = 0; i < count; ++i) {
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        std::atomic<Node *> &bucket(size_t hsh) {
+            return buckets[hsh & mask];
+        }
+    };
+
+    // A table retired with its nodes owns every chain still linked from its buckets.
+    struct Retired {
+        uint64_t epoch;
+        Node *node;
+        Table *table;
+    };
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};
+        bool in_use = false;
+    };
+
+    // Reader slots of one map. Threads hold it weakly, so a thread outliving the map drops its
+    // entry and a map outliving a thread gets the thread's slot back.
+    struct Registry {
+        const uint64_t id;
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ReaderSlot> > slots;
+
+        explicit Registry(uint64_t id_) : id(id_) {}
+    };
+
+    struct ThreadSlots {
+        struct Entry {
+            uint64_t id;
+            std::weak_ptr<Registry> registry;
+            ReaderSlot *slot;
+        };
+        std::vector<Entry> entries;
+        uint64_t last_id = 0;
+        ReaderSlot *last_slot = nullptr;
+
+        ~ThreadSlots() {
+            for (auto &entry: entries) {
+                if (auto registry = entry.registry.lock()) {
+                    std::lock_guard lock(registry->mutex);
+                    entry.slot->in_use = false;
+                }
+            }
+        }
+    };
+
+    struct ReadGuard {
+        ReaderSlot *slot;
+
+        ReadGuard(ReaderSlot *slot_, const std::atomic<uint64_t> &epoch) : slot(slot_) {
+            slot->epoch.store(epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~ReadGuard() {
+            slot->epoch.store(0, std::memory_order_release);
+        }
+    };
+
+    std::atomic<Table *> table;
+    std::atomic<size_t> sz{0};
+    std::atomic<uint64_t> epoch{1};
+    const std::shared_ptr<Registry> readers;
+    Hash hash;
+    Equal equal;
+
+    std::mutex write_mutex;
+    std::vector<Retired> retired;
+
+public:
+    ReadMostlyMap() : table(new Table(kMinBuckets)), readers(std::make_shared<Registry>(next_id_())) {}
+    ReadMostlyMap(const ReadMostlyMap &) = delete;
+    ReadMostlyMap &operator=(const ReadMostlyMap &) = delete;
+    // No reader or writer may be running.
+    ~ReadMostlyMap() {
+        for (auto &item: retired) {
+            free_(item);
+        }
+        free_({0, nullptr, table.load()});
+    }
+
+    std::optional<Value> find(const Key &key) const {
+        ReadGuard guard(reader_slot_(), epoch);
+        const Node *found = find_(key);
+        if (found == nullptr) {
+            return std::nullopt;
+        }
+        return found->value;
+    }
+    bool contains(const Key &key) const {
+        ReadGuard guard(reader_slot_(), epoch);
+        return find_(key) != nullptr;
+    }
+    size_t size() const {
+        return sz.load(std::memory_order_relaxed);
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Returns true when key was inserted, false when an existing value was replaced.
+    template<typename V>
+    bool insert_or_assign(const Key &key, V &&value) {
+        std::lock_guard lock(write_mutex);
+        size_t hsh = MixHash(hash(key));
+        auto [link, found] = locate_(key, hsh);
+        if (found != nullptr) {
+            Node *replacement = new Node(found->key, std::forward<V>(value), hsh,
+                                         found->next.load(std::memory_order_relaxed));
+            link->store(replacement, std::memory_order_release);
+            retire_(found, nullptr);
+            return false;
+        }
+        insert_(key, std::forward<V>(value), hsh);
+        return true;
+    }
+    // Returns false and leaves the map unchanged when key is already present.
+    template<typename V>
+    bool insert(const Key &key, V &&value) {
+        std::lock_guard lock(write_mutex);
+        size_t hsh = MixHash(hash(key));
+        if (locate_(key, hsh).second != nullptr) {
+            return false;
+        }
+        insert_(key, std::forward<V>(value), hsh);
+        return true;
+    }
+    bool erase(const Key &key) {
+        std::lock_guard lock(write_mutex);
+        auto [link, found] = locate_(key, MixHash(hash(key)));
+        if (found == nullptr) {
+            return false;
+        }
+        link->store(found->next.load(std::memory_order_relaxed), std::memory_order_release);
+        sz.store(sz.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        retire_(found, nullptr);
+        return true;
+    }
+    void clear() {
+        std::lock_guard lock(write_mutex);
+        Table *old = table.load(std::memory_order_relaxed);
+        table.store(new Table(kMinBuckets), std::memory_order_release);
+        sz.store(0, std::memory_order_relaxed);
+        retire_(nullptr, old);
+    }
+    void reserve(size_t count) {
+        std::lock_guard lock(write_mutex);
+        size_t buckets = PowerOfTwoBucketPolicy::bucket_count(count);
+        if (buckets > table.load(std::memory_order_relaxed)->mask + 1) {
+            rehash_(buckets);
+        }
+    }
+
+private:
+    static uint64_t next_id_() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1) + 1;
+    }
+
+    // The slot of the map read last is cached, so repeated lookups touch only thread-local memory.
+    // Otherwise the thread's entries are searched, dropping those of destroyed maps, and on a miss
+    // the map hands out a slot released by an exited thread or a new one.
+    ReaderSlot *reader_slot_() const {
+        thread_local ThreadSlots local;
+        const uint64_t id = readers->id;
+        if (local.last_id == id) {
+            return local.last_slot;
+        }
+        ReaderSlot *slot = nullptr;
+        size_t kept = 0;
+        for (auto &entry: local.entries) {
+            if (entry.registry.expired()) {
+                continue;
+            }
+            if (entry.id == id) {
+                slot = entry.slot;
+            }
+            local.entries[kept++] = std::move(entry);
+        }
+        local.entries.resize(kept);
+        if (slot == nullptr) {
+            std::lock_guard lock(readers->mutex);
+            for (auto &free_slot: readers->slots) {
+                if (!free_slot->in_use) {
+                    slot = free_slot.get();
+                    break;
+                }
+            }
+            if (slot == nullptr) {
+                readers->slots.push_back(std::make_unique<ReaderSlot>());
+                slot = readers->slots.back().get();
+            }
+            slot->in_use = true;
+            local.entries.push_back({id, readers, slot});
+        }
+        local.last_id = id;
+        local.last_slot = slot;
+        return slot;
+    }
+
+    const Node *find_(const Key &key) const {
+        size_t hsh = MixHash(hash(key));
+        Table *current = table.load(std::memory_order_acquire);
+        for (Node *cur = current->bucket(hsh).load(std::memory_order_acquire); cur != nullptr;
+             cur = cur->next.load(std::memory_order_acquire)) {
+            if (cur->hsh == hsh && equal(cur->key, key)) {
+                return cur;
+            }
+        }
+        return nullptr;
+    }
+
+    // Writer side: the link pointing at the node with key (or at the end of its chain) and the node.
+    std::pair<std::atomic<Node *> *, Node *> locate_(const Key &key, size_t hsh) {
+        std::atomic<Node *> *link = &table.load(std::memory_order_relaxed)->bucket(hsh);
+        for (Node *cur = link->load(std::memory_order_relaxed); cur != nullptr;
+             cur = link->load(std::memory_order_relaxed)) {
+            if (cur->hsh == hsh && equal(cur->key, key)) {
+                return {link, cur};
+            }
+            link = &cur->next;
+        }
+        return {link, nullptr};
+    }
+
+    template<typename V>
+    void insert_(const Key &key, V &&value, size_t hsh) {
+        size_t size = sz.load(std::memory_order_relaxed) + 1;
+        Table *current = table.load(std::memory_order_relaxed);
+        if (size > current->mask + 1) {
+            rehash_(2 * (current->mask + 1));
+            current = table.load(std::memory_order_relaxed);
+        }
+        std::atomic<Node *> &head = current->bucket(hsh);
+        head.store(new Node(key, std::forward<V>(value), hsh, head.load(std::memory_order_relaxed)),
+                   std::memory_order_release);
+        sz.store(size, std::memory_order_relaxed);
+    }
+
+    void rehash_(size_t count) {
+        Table *old = table.load(std::memory_order_relaxed);
+        Table *fresh = new Table(count);
+        for (size_t i = 0; i <= old->mask; ++i) {
+            for (Node *cur = old->buckets[i].load(std::memory_order_relaxed); cur != nullptr;
+                 cur = cur->next.load(std::memory_order_relaxed)) {
+                std::atomic<Node *> &head = fresh->bucket(cur->hsh);
+                head.store(new Node(cur->key, cur->value, cur->hsh, head.load(std::memory_order_relaxed)),
+                           std::memory_order_relaxed);
+            }
+        }
+        table.store(fresh, std::memory_order_release);
+        retire_(nullptr, old);
+    }
+
+    // Called with write_mutex held, after the node or table has been unlinked.
+    void retire_(Node *node, Table *old_table) {
+        uint64_t current = epoch.load(std::memory_order_relaxed);
+        retired.push_back({current, node, old_table});
+        epoch.store(current + 1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldest = current + 1;
+        {
+            std::lock_guard lock(readers->mutex);
+            for (auto &reader: readers->slots) {
+                uint64_t reader_epoch = reader->epoch.load(std::memory_order_acquire);
+                if (reader_epoch != 0 && reader_epoch < oldest) {
+                    oldest = reader_epoch;
+                }
+            }
+        }
+        size_t kept = 0;
+        for (auto &item: retired) {
+            if (item.epoch < oldest) {
+                free_(item);
+            } else {
+                retired[kept++] = item;
+            }
+        }
+        retired.resize(kept);
+    }
+
+    static void free_(const Retired &item) {
+        delete item.node;
+        if (item.table != nullptr) {
+            for (size_t i = 0; i <= item.table->mask; ++i) {
+                for (Node *cur = item.table->buckets[i].load(std::memory_order_relaxed); cur != nullptr;) {
+                    Node *next = cur->next.load(std::memory_order_relaxed);
+                    delete cur;
+                    cur = next;
+                }
+            }
+            delete item.table;
+        }
+    }
+};
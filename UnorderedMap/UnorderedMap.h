@@ -2,9 +2,32 @@
 
 #include <vector>
 #include <functional>
+#include <stdexcept>
 
+#include "BucketPolicy.h"
+#include "NodePool.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define UNORDERED_MAP_PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define UNORDERED_MAP_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0)
+#else
+#define UNORDERED_MAP_PREFETCH(address) static_cast<void>(address)
+#endif
+
+template<typename T, typename = void>
+struct IsTransparent : std::false_type {};
+
+template<typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent> > : std::true_type {};
+
+// The default BucketPolicy rounds bucket counts up to powers of two and masks a mixed hash, which
+// changes bucket_count() and iteration order from earlier versions; ModuloBucketPolicy restores the
+// raw hash modulo the requested bucket count.
 template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
-        typename Alloc = std::allocator<std::pair<const Key, Value> > >
+        typename Alloc = std::allocator<std::pair<const Key, Value> >, typename BucketPolicy = PowerOfTwoBucketPolicy,
+        bool UseNodePool = false>
 class UnorderedMap {
 
 private:
@@ -14,16 +37,30 @@ private:
     using common_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<A>;
     using AllocTraits = std::allocator_traits<common_allocator<node> >;
     using StandardAllocTraits = std::allocator_traits<Alloc>;
+    using bucket_table = std::vector<std::pair<node *, node *>, common_allocator<std::pair<node *, node *> > >;
 
     common_allocator<node> alloc;
     Alloc StandardAlloc = alloc;
-    std::vector<std::pair<node *, node *>, common_allocator<std::pair<node *, node *> > > h;
+    bucket_table h;
     node *fake;
     node *head;
     size_t sz;
     float max_load = 4;
     Hash hash;
     Equal equal;
+    // While an incremental rehash is running, buckets of old_h below migrated have been moved to h.
+    bucket_table old_h{alloc};
+    size_t migrated = 0;
+    size_t rehash_step = 0;
+
+    // Lookups by any K are enabled, as in C++20, when both Hash and Equal declare is_transparent.
+    template<typename K>
+    static constexpr bool is_transparent_ = IsTransparent<Hash>::value && IsTransparent<Equal>::value &&
+                                            !std::is_same_v<std::decay_t<K>, Key>;
+    template<typename K>
+    using enable_transparent_ = std::enable_if_t<is_transparent_<K> >;
+
+    static constexpr size_t kBatchSize = 32;
 
 public:
     using NodeType = std::pair<const Key, Value>;
@@ -34,19 +71,23 @@ public:
     }
     UnorderedMap(const UnorderedMap &other)
             : alloc(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_allocator())),
-              h(other.h.size(), alloc), fake(AllocTraits::allocate(alloc, 1)), head(fake), sz(0), max_load(other.max_load) {
+              h(other.h.size(), alloc), fake(AllocTraits::allocate(alloc, 1)), head(fake), sz(0), max_load(other.max_load),
+              rehash_step(other.rehash_step) {
         fake->next = fake;
         for (auto it = other.begin(); it != other.end(); ++it) {
-            node *new_node = construct_node(it.get_hash(), *it);
+            node *new_node = construct_node(it.mixed_hash(), *it);
             emplace_by_node_(new_node);
         }
     }
     UnorderedMap(UnorderedMap &&other)
             : alloc(other.alloc), h(std::move(other.h), alloc), fake(other.fake), head(other.head),
-              sz(other.sz), max_load(other.max_load) {
+              sz(other.sz), max_load(other.max_load), old_h(std::move(other.old_h), alloc), migrated(other.migrated),
+              rehash_step(other.rehash_step), pool(std::move(other.pool)) {
         other.fake = AllocTraits::allocate(alloc, 1);
         other.head = other.fake->next = other.fake;
         other.sz = 0;
+        other.old_h.clear();
+        other.migrated = 0;
     }
     ~UnorderedMap() {
         clear_();
@@ -58,15 +99,18 @@ public:
             alloc = other.alloc;
             StandardAlloc = other.StandardAlloc;
         }
-        h = std::vector<std::pair<node *, node *>, common_allocator<std::pair<node *, node *> > >(alloc);
+        max_load = other.max_load;
+        rehash_step = other.rehash_step;
+        h = bucket_table(alloc);
         for (auto it = other.begin(); it != other.end(); ++it) {
-            node *new_node = construct_node(it.get_hash(), *it);
+            node *new_node = construct_node(it.mixed_hash(), *it);
             emplace_by_node_(new_node);
         }
         return *this;
     }
     UnorderedMap &operator=(UnorderedMap &&other) {
         clear_();
+        AllocTraits::deallocate(alloc, fake, 1);
         h = std::move(other.h);
         fake = other.fake;
         head = other.head;
@@ -74,9 +118,15 @@ public:
         alloc = other.alloc;
         StandardAlloc = other.StandardAlloc;
         max_load = other.max_load;
+        old_h = std::move(other.old_h);
+        migrated = other.migrated;
+        rehash_step = other.rehash_step;
+        pool = std::move(other.pool);
         other.fake = AllocTraits::allocate(alloc, 1);
         other.head = other.fake->next = other.fake;
         other.sz = 0;
+        other.old_h.clear();
+        other.migrated = 0;
         return *this;
     }
     Alloc get_allocator() const {
@@ -138,7 +188,9 @@ public:
         bool operator!=(const common_iterator<false> &other) const {
             return !(*this == other);
         }
-        size_t get_hash() {
+        // The hash as stored, BucketPolicy::mix(hash_function()(key)); it is not the hsh that
+        // find(key, hsh) and emplace_hint_hash take.
+        size_t mixed_hash() const {
             return ptr->hsh;
         }
     };
@@ -170,12 +222,24 @@ public:
     Value &operator[](Key &&key) {
         return get_(std::move(key));
     }
+    template<typename K, typename = enable_transparent_<K>, typename = std::enable_if_t<std::is_constructible_v<Key, K> > >
+    Value &operator[](K &&key) {
+        return get_(std::forward<K>(key));
+    }
     Value &at(const Key &key) {
         return get_throw_(key);
     }
     const Value &at(const Key &key) const {
         return get_throw_(key);
     }
+    template<typename K, typename = enable_transparent_<K> >
+    Value &at(const K &key) {
+        return get_throw_(key);
+    }
+    template<typename K, typename = enable_transparent_<K> >
+    const Value &at(const K &key) const {
+        return get_throw_(key);
+    }
     size_t size() const {
         return sz;
     }
@@ -194,10 +258,59 @@ public:
     const_iterator find(const Key &key) const {
         return find_(key);
     }
+    template<typename K, typename = enable_transparent_<K> >
+    iterator find(const K &key) {
+        return find_(key);
+    }
+    template<typename K, typename = enable_transparent_<K> >
+    const_iterator find(const K &key) const {
+        return find_(key);
+    }
+    // hsh is the value hash_function() returns for key, computed once by the caller.
+    iterator find(const Key &key, size_t hsh) {
+        return find_by_hash_(key, BucketPolicy::mix(hsh));
+    }
+    const_iterator find(const Key &key, size_t hsh) const {
+        return find_by_hash_(key, BucketPolicy::mix(hsh));
+    }
+    template<typename K, typename = enable_transparent_<K> >
+    iterator find(const K &key, size_t hsh) {
+        return find_by_hash_(key, BucketPolicy::mix(hsh));
+    }
+    template<typename K, typename = enable_transparent_<K> >
+    const_iterator find(const K &key, size_t hsh) const {
+        return find_by_hash_(key, BucketPolicy::mix(hsh));
+    }
     template<typename... Args>
     std::pair<iterator, bool> emplace(Args &&... args) {
         return emplace_(std::forward<Args>(args)...);
     }
+    // Writes find(key) for every key in [first, last) to out. Keys are processed in groups: all
+    // hashes of a group are computed and their buckets prefetched, then the first nodes of those
+    // buckets, then the nodes after them (a walk reads the next node to see where the bucket ends),
+    // and only then are the chains walked, so the cache misses of a group overlap instead of being
+    // paid one after another. Each key is read twice, so [first, last) must be a forward range.
+    template<typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+        batch_(first, last, [&out](iterator it) { *out++ = it; });
+        return out;
+    }
+    template<typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        batch_(first, last, [&out](const_iterator it) { *out++ = it; });
+        return out;
+    }
+    template<typename ForwardIt, typename OutputIt>
+    OutputIt contains_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        batch_(first, last, [this, &out](const_iterator it) { *out++ = it != end(); });
+        return out;
+    }
+    // Like emplace, with hsh equal to hash_function() of the constructed key.
+    template<typename... Args>
+    std::pair<iterator, bool> emplace_hint_hash(size_t hsh, Args &&... args) {
+        node *new_node = construct_node(BucketPolicy::mix(hsh), std::forward<Args>(args)...);
+        return emplace_node_(new_node);
+    }
     template<typename InputIt>
     void insert(InputIt first, InputIt last) {
         while (first != last) {
@@ -213,16 +326,22 @@ public:
         return insert_(std::move(data));
     }
     void erase(const Key &key) {
-        erase_by_hash_(key, hash(key));
+        migrate_step_();
+        erase_by_hash_(key, hash_(key));
+    }
+    template<typename K, typename = enable_transparent_<K> >
+    void erase(const K &key) {
+        migrate_step_();
+        erase_by_hash_(key, hash_(key));
     }
     void erase(const_iterator it) {
-        erase_by_hash_(it->first, it.get_hash());
+        erase_by_hash_(it->first, it.mixed_hash());
     }
     void erase(const_iterator first, const_iterator last) {
         const_iterator prev = first;
         while (first != last) {
             ++first;
-            erase_by_hash_(prev->first, prev.get_hash());
+            erase_by_hash_(prev->first, prev.mixed_hash());
             prev = first;
         }
     }
@@ -244,6 +363,27 @@ public:
     void max_load_factor(float ml) {
         max_load = ml;
     }
+    // With buckets_per_op > 0 a growing table keeps its old bucket array next to the new one and
+    // every later insertion or erasure by key moves buckets_per_op old buckets over, so no single
+    // insertion relinks the whole map. Lookups and erasures consult whichever array holds the key's
+    // bucket. rehash, reserve, clear and incremental_rehash(0) finish a running migration at once.
+    // Insertions and erasures by key may reorder elements that follow their position during a
+    // migration; erasure through an iterator never does.
+    size_t incremental_rehash() const {
+        return rehash_step;
+    }
+    void incremental_rehash(size_t buckets_per_op) {
+        rehash_step = buckets_per_op;
+        if (rehash_step == 0) {
+            migrate_(old_h.size());
+        }
+    }
+    Hash hash_function() const {
+        return hash;
+    }
+    Equal key_eq() const {
+        return equal;
+    }
 
 private:
     struct node {
@@ -254,9 +394,23 @@ private:
         node(NodeType *data_, size_t hsh_) : data(data_), hsh(hsh_) {}
     };
 
+    struct no_pool {
+        template<typename A>
+        no_pool(const A &) {}
+    };
+
+    // With UseNodePool nodes are carved from slabs owned by the map: consecutive insertions get
+    // adjacent nodes, erased nodes are recycled through a free list and clear() frees whole slabs.
+    std::conditional_t<UseNodePool, NodePool<node, common_allocator<node> >, no_pool> pool{alloc};
+
     template<typename ...Args>
     node *construct_node(size_t hsh, Args &&...args) {
-        node *new_node = AllocTraits::allocate(alloc, 1);
+        node *new_node;
+        if constexpr (UseNodePool) {
+            new_node = pool.allocate();
+        } else {
+            new_node = AllocTraits::allocate(alloc, 1);
+        }
         StandardAllocTraits::construct(StandardAlloc, &new_node->data, std::forward<Args>(args)...);
         new_node->hsh = hsh;
         return new_node;
@@ -264,16 +418,91 @@ private:
 
     void destroy_node(node *delete_node) {
         StandardAllocTraits::destroy(StandardAlloc, &delete_node->data);
-        AllocTraits::deallocate(alloc, delete_node, 1);
+        if constexpr (UseNodePool) {
+            pool.deallocate(delete_node);
+        } else {
+            AllocTraits::deallocate(alloc, delete_node, 1);
+        }
+    }
+
+    template<typename K>
+    size_t hash_(const K &key) const {
+        return BucketPolicy::mix(hash(key));
+    }
+
+    size_t bucket_(size_t hsh) const {
+        return BucketPolicy::index(hsh, h.size());
+    }
+
+    std::pair<node *, node *> &entry_(size_t hsh) {
+        if (!old_h.empty()) {
+            size_t index = BucketPolicy::index(hsh, old_h.size());
+            if (index >= migrated) {
+                return old_h[index];
+            }
+        }
+        return h[bucket_(hsh)];
+    }
+
+    const std::pair<node *, node *> &entry_(size_t hsh) const {
+        return const_cast<UnorderedMap *>(this)->entry_(hsh);
+    }
+
+    // Links new_node in front of its bucket, or at the tail of the list when the bucket is empty.
+    void link_node_(node *new_node, std::pair<node *, node *> &bucket) {
+        if (bucket.first == nullptr) {
+            new_node->next = head->next;
+            bucket.first = head->next = new_node;
+            bucket.second = head;
+            head = new_node;
+            return;
+        }
+        new_node->next = bucket.first;
+        bucket.second->next = bucket.first = new_node;
+    }
+
+    // Moves up to count old buckets into h: the bucket's segment is cut out of the list and its
+    // nodes are linked again under their new buckets.
+    void migrate_(size_t count) {
+        for (; count > 0 && migrated < old_h.size(); --count) {
+            std::pair<node *, node *> &bucket = old_h[migrated];
+            node *first = bucket.first, *last = first;
+            if (first != nullptr) {
+                while (last->next != fake && &entry_(last->next->hsh) == &bucket) {
+                    last = last->next;
+                }
+                node *after = last->next;
+                bucket.second->next = after;
+                if (after != fake) {
+                    entry_(after->hsh).second = bucket.second;
+                }
+                if (last == head) {
+                    head = bucket.second;
+                }
+                last->next = nullptr;
+            }
+            bucket = {nullptr, nullptr};
+            ++migrated;
+            while (first != nullptr) {
+                node *next = first->next;
+                link_node_(first, entry_(first->hsh));
+                first = next;
+            }
+        }
+        if (migrated == old_h.size()) {
+            old_h = bucket_table(alloc);
+            migrated = 0;
+        }
     }
 
     void rehash_(size_t count) {
-        std::vector<std::pair<node *, node *>, common_allocator<std::pair<node *, node *> > > tmp(count, alloc);
+        count = BucketPolicy::bucket_count(count);
+        bucket_table tmp(count, alloc);
         node *cur = fake->next;
         while (cur != fake) {
             node *prev = cur;
             cur = cur->next;
-            size_t index = prev->hsh % count;
+            size_t index = BucketPolicy::index(prev->hsh, count);
             prev->next = tmp[index].first;
             tmp[index].first = prev;
         }
@@ -290,11 +519,13 @@ private:
         head = cur;
         cur->next = fake;
         h = std::move(tmp);
+        old_h = bucket_table(alloc);
+        migrated = 0;
     }
 
     template<typename NodeKey>
     Value &get_(NodeKey &&key) {
-        size_t hsh = hash(key);
+        size_t hsh = hash_(key);
         iterator it = find_by_hash_(key, hsh);
         if (it == end()) {
             node *new_node = construct_node(hsh, std::forward<NodeKey>(key), Value());
@@ -303,7 +534,8 @@ private:
         return it->second;
     }
 
-    Value &get_throw_(const Key &key) const {
+    template<typename K>
+    Value &get_throw_(const K &key) const {
         iterator it = find_(key);
         if (it == end()) {
             throw std::out_of_range("the container does not have an element with the specified key");
@@ -311,12 +543,13 @@ private:
         return it->second;
     }
 
-    iterator find_by_hash_(const Key &key, size_t hsh) const {
+    template<typename K>
+    iterator find_by_hash_(const K &key, size_t hsh) const {
         if (!sz) {
             return iterator(fake);
         }
-        size_t index = hsh % h.size();
-        node *cur = h[index].first;
+        const std::pair<node *, node *> &bucket = entry_(hsh);
+        node *cur = bucket.first;
         if (cur == nullptr) {
             return iterator(fake);
         }
@@ -325,37 +558,72 @@ private:
                 return iterator(cur);
             }
             cur = cur->next;
-        } while (cur != fake && cur->hsh % h.size() == index);
+        } while (cur != fake && &entry_(cur->hsh) == &bucket);
         return iterator(fake);
     }
 
-    iterator find_(const Key &key) const {
-        return find_by_hash_(key, hash(key));
+    template<typename K>
+    iterator find_(const K &key) const {
+        return find_by_hash_(key, hash_(key));
+    }
+
+    template<typename ForwardIt, typename Function>
+    void batch_(ForwardIt first, ForwardIt last, Function function) const {
+        size_t hashes[kBatchSize];
+        const std::pair<node *, node *> *buckets[kBatchSize];
+        while (first != last) {
+            ForwardIt group = first;
+            size_t count = 0;
+            for (; first != last && count < kBatchSize; ++first, ++count) {
+                hashes[count] = hash_(*first);
+                if (sz) {
+                    buckets[count] = &entry_(hashes[count]);
+                    UNORDERED_MAP_PREFETCH(buckets[count]);
+                }
+            }
+            if (sz) {
+                for (size_t i = 0; i < count; ++i) {
+                    UNORDERED_MAP_PREFETCH(buckets[i]->first);
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    if (buckets[i]->first != nullptr) {
+                        UNORDERED_MAP_PREFETCH(buckets[i]->first->next);
+                    }
+                }
+            }
+            for (size_t i = 0; i < count; ++i, ++group) {
+                function(find_by_hash_(*group, hashes[i]));
+            }
+        }
     }
 
     float coefficient_() {
         return std::max(2.0f, 2 * max_load_factor());
     }
 
+    void migrate_step_() {
+        if (!old_h.empty()) {
+            migrate_(rehash_step);
+        }
+    }
+
     void fix_table_() {
+        migrate_step_();
         if (bucket_count() < (size() / max_load_factor() + 1)) {
-            rehash(coefficient_() * (size() / max_load_factor() + 1));
+            size_t count = coefficient_() * (size() / max_load_factor() + 1);
+            if (rehash_step == 0 || h.empty()) {
+                rehash(count);
+            } else {
+                migrate_(old_h.size());
+                old_h = std::move(h);
+                h = bucket_table(BucketPolicy::bucket_count(count), alloc);
+            }
         }
     }
 
     std::pair<iterator, bool> emplace_by_node_(node *new_node) {
         fix_table_();
-        size_t index = new_node->hsh % h.size();
-        if (h[index].first == nullptr) {
-            new_node->next = head->next;
-            h[index].first = head->next = new_node;
-            h[index].second = head;
-            head = new_node;
-            ++sz;
-            return {iterator(new_node), true};
-        }
-        new_node->next = h[index].first;
-        h[index].second->next = h[index].first = new_node;
+        link_node_(new_node, entry_(new_node->hsh));
         ++sz;
         return {iterator(new_node), true};
     }
@@ -363,8 +631,12 @@ private:
     template<typename... Args>
     std::pair<iterator, bool> emplace_(Args &&... args) {
         node *new_node = construct_node(0, std::forward<Args>(args)...);
-        size_t hsh = hash(new_node->data.first);
-        iterator it = find_by_hash_(new_node->data.first, new_node->hsh = hsh);
+        new_node->hsh = hash_(new_node->data.first);
+        return emplace_node_(new_node);
+    }
+
+    std::pair<iterator, bool> emplace_node_(node *new_node) {
+        iterator it = find_by_hash_(new_node->data.first, new_node->hsh);
         if (it != end()) {
             destroy_node(new_node);
             return {it, false};
@@ -374,7 +646,7 @@ private:
 
     template<typename Node>
     std::pair<iterator, bool> insert_(Node &&data) {
-        size_t hsh = hash(data.first);
+        size_t hsh = hash_(data.first);
         iterator it = find_by_hash_(data.first, hsh);
         if (it != end()) {
             return {it, false};
@@ -383,12 +655,13 @@ private:
         return emplace_by_node_(new_node);
     }
 
-    void erase_by_hash_(const Key &key, size_t hsh) {
+    template<typename K>
+    void erase_by_hash_(const K &key, size_t hsh) {
         if (!sz) {
             return;
         }
-        size_t index = hsh % h.size();
-        std::pair<node *, node *> cur = h[index];
+        std::pair<node *, node *> &bucket = entry_(hsh);
+        std::pair<node *, node *> cur = bucket;
         if (cur.first == nullptr) {
             return;
         }
@@ -398,15 +671,15 @@ private:
                     head = cur.second;
                 }
                 node *next = cur.first->next;
-                size_t index_ = next->hsh % h.size();
-                if (cur.second == fake || index != cur.second->hsh % h.size()) {
-                    if (next == fake) {
-                        h[index].first = h[index].second = nullptr;
-                    } else if (index != index_) {
-                        h[index_].second = cur.second;
-                        h[index].first = h[index].second = nullptr;
+                bool last_in_bucket = next == fake || &entry_(next->hsh) != &bucket;
+                if (next != fake && last_in_bucket) {
+                    entry_(next->hsh).second = cur.second;
+                }
+                if (cur.first == bucket.first) {
+                    if (last_in_bucket) {
+                        bucket.first = bucket.second = nullptr;
                     } else {
-                        h[index].first = next;
+                        bucket.first = next;
                     }
                 }
                 cur.second->next = next;
@@ -416,17 +689,28 @@ private:
             }
             cur.second = cur.first;
             cur.first = cur.first->next;
-        } while (cur.first != fake && cur.first->hsh % h.size() == index);
+        } while (cur.first != fake && &entry_(cur.first->hsh) == &bucket);
     }
 
     void clear_() {
-        for (node *cur = fake->next; cur != fake;) {
-            node *tmp = cur;
-            cur = cur->next;
-            destroy_node(tmp);
+        if constexpr (UseNodePool) {
+            if constexpr (!std::is_trivially_destructible_v<NodeType>) {
+                for (node *cur = fake->next; cur != fake; cur = cur->next) {
+                    StandardAllocTraits::destroy(StandardAlloc, &cur->data);
+                }
+            }
+            pool.release();
+        } else {
+            for (node *cur = fake->next; cur != fake;) {
+                node *tmp = cur;
+                cur = cur->next;
+                destroy_node(tmp);
+            }
         }
         head = fake->next = fake;
         sz = 0;
         h.assign(h.size(), {nullptr, nullptr});
+        old_h = bucket_table(alloc);
+        migrated = 0;
     }
 };
\ No newline at end of file
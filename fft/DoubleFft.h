@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Double precision radix-2 FFT over split real/imaginary arrays. Twiddles are
+// computed directly with cos/sin once per size and reused by every transform,
+// so their error does not accumulate along a stage.
+//
+// Error guarantee (Percival, "Rapid multiplication modulo the sum and
+// difference of highly composite numbers", 2003): for inputs x, y the
+// convolution computed here differs from the exact one by at most
+//     ||x||_2 * ||y||_2 * ((1 + e)^3k * (1 + e * sqrt 5)^(3k + 1) * (1 + b)^3k - 1)
+// in every coefficient, with e = 2^-53, b the twiddle error (<= e) and
+// k = log2(size) + 1 (one level is added for real-input packing). ErrorBound
+// evaluates this; integer results are exact after rounding while it is
+// below 0.5. For size 2^20 that holds for coefficients up to about 2^12 in
+// absolute value, for size 2^16 up to about 2^14.
+class DoubleFft {
+public:
+    DoubleFft(size_t size = 1) {
+        Reserve(size);
+    }
+
+    void Reserve(size_t size) {
+        size_t capacity = std::max<size_t>(cos_.size(), 2);
+        while (capacity < size) {
+            capacity <<= 1;
+        }
+        if (capacity == cos_.size()) {
+            return;
+        }
+        cos_.resize(capacity);
+        sin_.resize(capacity);
+        const double pi = std::acos(-1.0);
+        for (size_t half = 1; half < capacity; half <<= 1) {
+            for (size_t j = 0; j < half; ++j) {
+                cos_[half + j] = std::cos(pi * j / half);
+                sin_[half + j] = -std::sin(pi * j / half);
+            }
+        }
+    }
+
+    // In-place unnormalized transform of a power-of-two size; the inverse
+    // swaps the real and imaginary parts around the forward transform.
+    void Transform(double *re, double *im, size_t size, bool inverse = false) {
+        if (inverse) {
+            std::swap(re, im);
+        }
+        Reserve(size);
+        for (size_t i = 1, j = 0; i < size; ++i) {
+            size_t bit = size >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+        for (size_t i = 0; i + 1 < size; i += 2) {
+            double xr = re[i + 1], xi = im[i + 1];
+            re[i + 1] = re[i] - xr;
+            im[i + 1] = im[i] - xi;
+            re[i] += xr;
+            im[i] += xi;
+        }
+        for (size_t half = 2; half < size; half <<= 1) {
+            const double *wr = cos_.data() + half;
+            const double *wi = sin_.data() + half;
+            for (size_t i = 0; i < size; i += half << 1) {
+                double *ar = re + i, *ai = im + i;
+                double *br = re + i + half, *bi = im + i + half;
+                for (size_t j = 0; j < half; ++j) {
+                    double xr = br[j] * wr[j] - bi[j] * wi[j];
+                    double xi = br[j] * wi[j] + bi[j] * wr[j];
+                    br[j] = ar[j] - xr;
+                    bi[j] = ai[j] - xi;
+                    ar[j] += xr;
+                    ai[j] += xi;
+                }
+            }
+        }
+    }
+
+    // Linear convolution of two real sequences using two complex transforms:
+    // a and b are packed as the real and imaginary parts of one input.
+    std::vector<double> Convolve(const std::vector<double> &a, const std::vector<double> &b) {
+        if (a.empty() || b.empty()) {
+            return {};
+        }
+        size_t result_size = a.size() + b.size() - 1;
+        size_t size = 1;
+        while (size < result_size) {
+            size <<= 1;
+        }
+        std::vector<double> re(size), im(size);
+        std::copy(a.begin(), a.end(), re.begin());
+        std::copy(b.begin(), b.end(), im.begin());
+        Transform(re.data(), im.data(), size);
+        std::vector<double> product_re(size), product_im(size);
+        const double scale = 0.25 / size;
+        for (size_t k = 0; k < size; ++k) {
+            size_t j = (size - k) & (size - 1);
+            double dr = re[k] * re[k] - im[k] * im[k] - re[j] * re[j] + im[j] * im[j];
+            double di = 2 * re[k] * im[k] + 2 * re[j] * im[j];
+            product_re[k] = di * scale;
+            product_im[k] = -dr * scale;
+        }
+        Transform(product_re.data(), product_im.data(), size, true);
+        product_re.resize(result_size);
+        return product_re;
+    }
+
+    template<typename T>
+    std::vector<long long> ConvolveRounded(const std::vector<T> &a, const std::vector<T> &b) {
+        auto product = Convolve(std::vector<double>(a.begin(), a.end()), std::vector<double>(b.begin(), b.end()));
+        std::vector<long long> result(product.size());
+        for (size_t i = 0; i < product.size(); ++i) {
+            result[i] = std::llround(product[i]);
+        }
+        return result;
+    }
+
+    template<typename T>
+    static double Norm(const std::vector<T> &a) {
+        double sum = 0;
+        for (const auto &x: a) {
+            sum += static_cast<double>(x) * x;
+        }
+        return std::sqrt(sum);
+    }
+
+    static double ErrorBound(size_t size, double norm_a, double norm_b) {
+        const double eps = std::numeric_limits<double>::epsilon() / 2;
+        double levels = 1;
+        for (size_t pow = 1; pow < size; pow <<= 1) {
+            ++levels;
+        }
+        double log_growth = 3 * levels * std::log1p(eps) + (3 * levels + 1) * std::log1p(eps * std::sqrt(5.0)) +
+                            3 * levels * std::log1p(eps);
+        return norm_a * norm_b * std::expm1(log_growth);
+    }
+
+private:
+    std::vector<double> cos_;
+    std::vector<double> sin_;
+};
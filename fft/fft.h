@@ -3,56 +3,93 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
 
-class Polynomial {
-public:
-    Polynomial(int degree = -1) : polynomial(degree + 1) {}
-
-    Polynomial(const Polynomial &other) : polynomial(other.polynomial) {}
+// Stages of Polynomial multiplication modulo 998244353: the NTT (Fft with forward or inverse
+// twiddles, PointwiseMultiply between them) and the quadratic kernels for small sizes. They work on
+// reduced coefficients and are public so the stages can be used and timed on their own.
+class PolynomialKernels {
+    class Barrier {
+    public:
+        explicit Barrier(size_t count) : count_(count) {}
 
-    Polynomial(Polynomial &&other) : polynomial(std::move(other.polynomial)) {}
-
-    auto &operator[](size_t index) {
-        return polynomial[index];
-    }
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            const size_t generation = generation_;
+            if (++waiting_ == count_) {
+                waiting_ = 0;
+                ++generation_;
+                lock.unlock();
+                condition_.notify_all();
+                return;
+            }
+            condition_.wait(lock, [&]() { return generation != generation_; });
+        }
 
-    auto operator[](size_t index) const {
-        return polynomial[index];
-    }
+    private:
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        const size_t count_;
+        size_t waiting_ = 0;
+        size_t generation_ = 0;
+    };
 
-    Polynomial operator*(const Polynomial &poly) const {
-        return Multiply(*this, poly);
-    }
+public:
+    static const int mod = 998244353;
+    static const uint32_t umod = mod;
+    static const size_t kSchoolbookSize = 32;
 
-    void SetDegree(int new_degree) {
-        polynomial.resize(new_degree + 1);
-    }
+    // One of size workers started once per multiplication. Every pass splits its index range
+    // between the workers with Range, and Sync waits for all of them before the next pass.
+    class Team {
+    public:
+        Team(size_t index = 0, size_t size = 1, Barrier *barrier = nullptr)
+                : index_(index), size_(size), barrier_(barrier) {}
 
-    int GetDegree() {
-        return int(polynomial.size()) - 1;
-    }
+        std::pair<size_t, size_t> Range(size_t count) const {
+            const size_t block = (count + size_ - 1) / size_;
+            const size_t begin = std::min(count, index_ * block);
+            return {begin, std::min(count, begin + block)};
+        }
+        void Sync() const {
+            if (barrier_) {
+                barrier_->Wait();
+            }
+        }
 
-private:
-    static const int mod = 998244353;
-    std::vector<int> polynomial;
+    private:
+        size_t index_;
+        size_t size_;
+        Barrier *barrier_;
+    };
 
-    int64_t BinPow(int64_t a, int64_t power) const {
-        int64_t result = 1;
-        while (power) {
-            if (power & 1) {
-                result = (result * a) % mod;
-            }
-            a = (a * a) % mod;
-            power >>= 1;
+    template<class Function>
+    static void RunTeam(size_t threads, Function function) {
+        if (threads <= 1) {
+            function(Team());
+            return;
+        }
+        Barrier barrier(threads);
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < threads; ++i) {
+            pool.emplace_back([&, i]() { function(Team(i, threads, &barrier)); });
+        }
+        function(Team(0, threads, &barrier));
+        for (auto &thread: pool) {
+            thread.join();
         }
-        return result;
     }
 
-    int64_t GetReversed(int64_t a) const {
+    static int64_t GetReversed(int64_t a) {
         return BinPow(a, mod - 2);
     }
 
-    std::vector<int> GetRev(int size) const {
+    static std::vector<int> GetRev(int size) {
         std::vector<int> rev(size);
         int log = 0;
         while (size > 1) {
@@ -69,7 +106,173 @@ private:
         return rev;
     }
 
-    std::vector<int> GetRoots(int pow2, bool reverse) const {
+    // Roots of every stage, stage pow at [pow / 2, pow), with their Shoup constants.
+    struct Twiddles {
+        std::vector<uint32_t> root;
+        std::vector<uint32_t> root_shoup;
+    };
+
+    static Twiddles GetTwiddles(size_t n, bool reverse) {
+        Twiddles twiddles{std::vector<uint32_t>(n), std::vector<uint32_t>(n)};
+        for (size_t pow = 2; pow <= n; pow <<= 1) {
+            auto stage_root = GetRoots(pow, reverse);
+            for (size_t s = 0; s < stage_root.size(); ++s) {
+                twiddles.root[(pow >> 1) + s] = stage_root[s];
+                twiddles.root_shoup[(pow >> 1) + s] = GetShoup(stage_root[s]);
+            }
+        }
+        return twiddles;
+    }
+
+    static uint32_t Reduce(uint32_t x) {
+        if (x >= 2 * umod) x -= 2 * umod;
+        if (x >= umod) x -= umod;
+        return x;
+    }
+
+    // Harvey's lazy butterflies: inputs in [0, 4 * mod), outputs in [0, 4 * mod), not scaled by 1 / n.
+    // Called by every worker of team; returns once all of them have finished the transform.
+    static void Fft(std::vector<uint32_t> &cf, const std::vector<int> &rev, const Twiddles &twiddles,
+                    const Team &team = Team()) {
+        const size_t n = cf.size();
+        auto [rev_begin, rev_end] = team.Range(n);
+        for (size_t i = rev_begin; i < rev_end; ++i) {
+            if (static_cast<int>(i) < rev[i]) {
+                std::swap(cf[i], cf[rev[i]]);
+            }
+        }
+        team.Sync();
+        auto [begin, end] = team.Range(n >> 1);
+        for (size_t pow = 2; pow <= n; pow <<= 1) {
+            const size_t half = pow >> 1;
+            const uint32_t *w = twiddles.root.data() + half, *w_shoup = twiddles.root_shoup.data() + half;
+            for (size_t k = begin; k < end; ++k) {
+                size_t s = k & (half - 1);
+                size_t i = ((k - s) << 1) + s;
+                uint32_t x = cf[i];
+                if (x >= 2 * umod) x -= 2 * umod;
+                uint32_t y = MulShoup(cf[i + half], w[s], w_shoup[s]);
+                cf[i] = x + y;
+                cf[i + half] = x - y + 2 * umod;
+            }
+            team.Sync();
+        }
+    }
+
+    // Multiplies transforms in [0, 4 * mod) and applies the 1 / n of the inverse transform, with
+    // reversed_n = GetReversed(n) computed once by the caller.
+    static void PointwiseMultiply(std::vector<uint32_t> &cf_first, const std::vector<uint32_t> &cf_second,
+                                  uint32_t reversed_n, const Team &team = Team()) {
+        const size_t n = cf_first.size();
+        const uint32_t reversed_n_shoup = GetShoup(reversed_n);
+        auto [begin, end] = team.Range(n);
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t product = static_cast<uint32_t>(static_cast<uint64_t>(cf_first[i]) * cf_second[i] % mod);
+            cf_first[i] = MulShoup(product, reversed_n, reversed_n_shoup);
+        }
+        team.Sync();
+    }
+
+    static void Schoolbook(const int *first, size_t first_size, const int *second, size_t second_size,
+                           int *result) {
+        const size_t result_size = first_size + second_size - 1;
+        for (size_t k = 0; k < result_size; ++k) {
+            size_t i = k < second_size ? 0 : k - second_size + 1;
+            const size_t end = std::min(k + 1, first_size);
+            uint64_t sum = 0;
+            while (i < end) {
+                // Four independent accumulators hide the multiply-add latency; kLazyTerms products
+                // below mod^2 and one residue still fit in 64 bits before the reduction.
+                const size_t stop = std::min(end, i + kLazyTerms);
+                uint64_t sum1 = 0, sum2 = 0, sum3 = 0;
+                for (; i + 4 <= stop; i += 4) {
+                    sum += static_cast<uint64_t>(first[i]) * static_cast<uint32_t>(second[k - i]);
+                    sum1 += static_cast<uint64_t>(first[i + 1]) * static_cast<uint32_t>(second[k - i - 1]);
+                    sum2 += static_cast<uint64_t>(first[i + 2]) * static_cast<uint32_t>(second[k - i - 2]);
+                    sum3 += static_cast<uint64_t>(first[i + 3]) * static_cast<uint32_t>(second[k - i - 3]);
+                }
+                for (; i < stop; ++i) {
+                    sum += static_cast<uint64_t>(first[i]) * static_cast<uint32_t>(second[k - i]);
+                }
+                sum = (sum + sum1 + sum2 + sum3) % mod;
+            }
+            result[k] = static_cast<int>(sum);
+        }
+    }
+
+    static void Karatsuba(const int *first, const int *second, size_t size, int *result) {
+        if (size <= kSchoolbookSize) {
+            Schoolbook(first, size, second, size, result);
+            return;
+        }
+        const size_t low = size / 2, high = size - low;
+        std::vector<int> first_sum(first + low, first + size), second_sum(second + low, second + size);
+        for (size_t i = 0; i < low; ++i) {
+            first_sum[i] += first[i];
+            if (first_sum[i] >= mod) first_sum[i] -= mod;
+            second_sum[i] += second[i];
+            if (second_sum[i] >= mod) second_sum[i] -= mod;
+        }
+        std::vector<int> middle(2 * high - 1);
+        Karatsuba(first_sum.data(), second_sum.data(), high, middle.data());
+        Karatsuba(first, second, low, result);
+        result[2 * low - 1] = 0;
+        Karatsuba(first + low, second + low, high, result + 2 * low);
+        for (size_t i = 0; i < 2 * low - 1; ++i) {
+            middle[i] -= result[i];
+            if (middle[i] < 0) middle[i] += mod;
+        }
+        for (size_t i = 0; i < 2 * high - 1; ++i) {
+            middle[i] -= result[2 * low + i];
+            if (middle[i] < 0) middle[i] += mod;
+        }
+        for (size_t i = 0; i < 2 * high - 1; ++i) {
+            result[low + i] += middle[i];
+            if (result[low + i] >= mod) result[low + i] -= mod;
+        }
+    }
+
+    static std::vector<int> NttMultiply(const std::vector<int> &first, const std::vector<int> &second,
+                                        size_t threads) {
+        const size_t result_size = first.size() + second.size() - 1;
+        size_t pow2 = 1;
+        while (pow2 < result_size) pow2 <<= 1;
+        std::vector<uint32_t> cf_first(pow2), cf_second(pow2);
+        std::copy(first.begin(), first.end(), cf_first.begin());
+        std::copy(second.begin(), second.end(), cf_second.begin());
+        std::vector<int> rev = GetRev(pow2);
+        const Twiddles forward = GetTwiddles(pow2, false), inverse = GetTwiddles(pow2, true);
+        const uint32_t reversed_n = static_cast<uint32_t>(GetReversed(pow2));
+        RunTeam(pow2 < kParallelSize ? 1 : threads, [&](const Team &team) {
+            Fft(cf_first, rev, forward, team);
+            Fft(cf_second, rev, forward, team);
+            PointwiseMultiply(cf_first, cf_second, reversed_n, team);
+            Fft(cf_first, rev, inverse, team);
+        });
+        std::vector<int> result(result_size);
+        for (size_t i = 0; i < result_size; ++i) {
+            result[i] = static_cast<int>(Reduce(cf_first[i]));
+        }
+        return result;
+    }
+
+private:
+    static const int kParallelSize = 1 << 15;
+    static const size_t kLazyTerms = 16;
+
+    static int64_t BinPow(int64_t a, int64_t power) {
+        int64_t result = 1;
+        while (power) {
+            if (power & 1) {
+                result = (result * a) % mod;
+            }
+            a = (a * a) % mod;
+            power >>= 1;
+        }
+        return result;
+    }
+
+    static std::vector<int> GetRoots(int pow2, bool reverse) {
         const int first_root = 31;
         const int reversed_root = 128805723;
         int64_t base_root = reverse ? reversed_root : first_root;
@@ -84,66 +287,122 @@ private:
         return root;
     }
 
-    void Fft(std::vector<int> &cf, const std::vector<int> &rev, bool reverse = false) const {
-        for (int i = 0; i < static_cast<int>(cf.size()); ++i) {
-            if (i < rev[i]) {
-                std::swap(cf[i], cf[rev[i]]);
+    static uint32_t GetShoup(uint32_t w) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(w) << 32) / mod);
+    }
+
+    // Returns a * w modulo mod in [0, 2 * mod) for any 32-bit a.
+    static uint32_t MulShoup(uint32_t a, uint32_t w, uint32_t w_shoup) {
+        uint32_t quotient = static_cast<uint32_t>((static_cast<uint64_t>(a) * w_shoup) >> 32);
+        return a * w - quotient * static_cast<uint32_t>(mod);
+    }
+};
+
+class Polynomial {
+public:
+    Polynomial(int degree = -1) : polynomial(degree + 1) {}
+
+    Polynomial(const Polynomial &other) : polynomial(other.polynomial) {}
+
+    Polynomial(Polynomial &&other) : polynomial(std::move(other.polynomial)) {}
+
+    Polynomial &operator=(const Polynomial &other) = default;
+
+    Polynomial &operator=(Polynomial &&other) = default;
+
+    auto &operator[](size_t index) {
+        return polynomial[index];
+    }
+
+    auto operator[](size_t index) const {
+        return polynomial[index];
+    }
+
+    Polynomial operator*(const Polynomial &poly) const {
+        return Multiply(*this, poly);
+    }
+
+    Polynomial ParallelMultiply(const Polynomial &poly, size_t threads = 0) const {
+        return Multiply(*this, poly, GetThreads(threads));
+    }
+
+    static std::vector<Polynomial> MultiplyBatch(const std::vector<std::pair<Polynomial, Polynomial>> &products,
+                                                 size_t threads = 0) {
+        std::vector<Polynomial> result(products.size());
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < products.size(); i = next++) {
+                result[i] = products[i].first * products[i].second;
             }
+        };
+        threads = std::min(GetThreads(threads), products.size());
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < threads; ++i) {
+            pool.emplace_back(worker);
         }
-        for (int pow = 2; pow <= static_cast<int>(cf.size()); pow <<= 1) {
-            auto root = GetRoots(pow, reverse);
-            for (int i = 0; i < static_cast<int>(cf.size()); i += pow) {
-                for (int s = 0; s < (pow >> 1); ++s) {
-                    int x = cf[i + s];
-                    int y = (1ll * cf[i + s + (pow >> 1)] * root[s]) % mod;
-                    cf[i + s] = x + y;
-                    if (x + y >= mod) cf[i + s] -= mod;
-                    cf[i + s + (pow >> 1)] = x - y;
-                    if (x - y < 0) cf[i + s + (pow >> 1)] += mod;
-                }
-            }
+        worker();
+        for (auto &thread: pool) {
+            thread.join();
         }
-        if (reverse) {
-            int64_t reversed_n = GetReversed(cf.size());
-            for (int &c: cf) {
-                c = (c * reversed_n) % mod;
-            }
+        return result;
+    }
+
+    void SetDegree(int new_degree) {
+        polynomial.resize(new_degree + 1);
+    }
+
+    int GetDegree() {
+        return int(polynomial.size()) - 1;
+    }
+
+private:
+    using Kernels = PolynomialKernels;
+
+    static const size_t kKaratsubaSize = 256;
+    std::vector<int> polynomial;
+
+    static size_t GetThreads(size_t threads) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
         }
+        return std::max<size_t>(threads, 1);
     }
 
-    Polynomial Multiply(const Polynomial &poly1, const Polynomial &poly2) const {
+    static Polynomial Multiply(const Polynomial &poly1, const Polynomial &poly2, size_t threads = 1) {
+        Polynomial result;
+        if (poly1.polynomial.empty() || poly2.polynomial.empty()) {
+            return result;
+        }
         std::vector<int> cf_first(poly1.polynomial);
         std::vector<int> cf_second(poly2.polynomial);
-        int pow2 = 1;
-        while (pow2 < static_cast<int>(std::max(cf_first.size(), cf_second.size()))) pow2 <<= 1;
-        cf_first.resize(pow2 << 1);
-        cf_second.resize(cf_first.size());
-        for (int i = 0; i < static_cast<int>(cf_first.size()); ++i) {
-            if (cf_first[i] < 0) {
-                cf_first[i] += mod;
-            }
-            if (cf_second[i] < 0) {
-                cf_second[i] += mod;
+        for (int &c: cf_first) {
+            if (c < 0) {
+                c += Kernels::mod;
             }
         }
-        std::vector<int> rev = GetRev(cf_first.size());
-        Fft(cf_first, rev);
-        Fft(cf_second, rev);
-        for (int i = 0; i < static_cast<int>(cf_first.size()); ++i) {
-            cf_first[i] = (1ll * cf_first[i] * cf_second[i]) % mod;
-        }
-        Fft(cf_first, rev, true);
-        Polynomial result(int(cf_first.size()) - 1);
-        for (int i = 0; i < static_cast<int>(cf_first.size()); ++i) {
-            result[i] = cf_first[i];
-        }
-        for (int i = result.GetDegree(); i >= 0; --i) {
-            if (result[i]) {
-                result.SetDegree(i);
-                return result;
+        for (int &c: cf_second) {
+            if (c < 0) {
+                c += Kernels::mod;
             }
         }
-        result.SetDegree(-1);
+        if (cf_first.size() > cf_second.size()) {
+            std::swap(cf_first, cf_second);
+        }
+        auto &product = result.polynomial;
+        if (cf_first.size() <= Kernels::kSchoolbookSize) {
+            product.resize(cf_first.size() + cf_second.size() - 1);
+            Kernels::Schoolbook(cf_first.data(), cf_first.size(), cf_second.data(), cf_second.size(), product.data());
+        } else if (cf_second.size() <= kKaratsubaSize && cf_second.size() <= 2 * cf_first.size()) {
+            cf_first.resize(cf_second.size());
+            product.resize(2 * cf_second.size() - 1);
+            Kernels::Karatsuba(cf_first.data(), cf_second.data(), cf_second.size(), product.data());
+            product.resize(poly1.polynomial.size() + poly2.polynomial.size() - 1);
+        } else {
+            product = Kernels::NttMultiply(cf_first, cf_second, threads);
+        }
+        while (!product.empty() && !product.back()) {
+            product.pop_back();
+        }
         return result;
     }
 };
\ No newline at end of file